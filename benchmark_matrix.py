@@ -0,0 +1,287 @@
+#!/usr/bin/env python3
+
+# Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+
+"""Throughput benchmark over a matrix of data shapes and parser options.
+
+Results are printed as a table and may be saved as JSON; with a saved
+baseline, results which are slower than it by more than the threshold
+are reported as regressions, and the exit status is nonzero.
+
+    ./benchmark_matrix.py --output baseline.json
+    ./benchmark_matrix.py --baseline baseline.json --threshold 0.1
+"""
+
+import argparse
+import io
+import itertools
+import json
+import os
+import platform
+import sys
+import tempfile
+import time
+
+from jsonslicer import JsonSlicer
+
+
+def gen_flat(scale):
+    # the shape of benchmark.py
+    return '{"level1":{"level2":[' + ','.join('{{"id":{}}}'.format(i) for i in range(scale * 1000)) + ']}}', ('level1', 'level2', None)
+
+
+def gen_deep(scale):
+    # each object is 32 levels deep
+    obj = '{"id":1}'
+    for i in range(32):
+        obj = '{{"k{}":[{}]}}'.format(i, obj)
+    return '[' + ','.join([obj] * (scale * 100)) + ']', (None,)
+
+
+def gen_wide(scale):
+    # objects with 200 fields each
+    obj = '{' + ','.join('"field_{}":{}'.format(i, i) for i in range(200)) + '}'
+    return '[' + ','.join([obj] * (scale * 10)) + ']', (None,)
+
+
+def gen_long_strings(scale):
+    return '[' + ','.join('"{}"'.format('x' * 4096) for _ in range(scale * 25)) + ']', (None,)
+
+
+def gen_escaped_strings(scale):
+    value = json.dumps('line\n"quoted"\tтекст\\' * 64)
+    return '[' + ','.join([value] * (scale * 50)) + ']', (None,)
+
+
+def gen_numbers(scale):
+    return '[' + ','.join('[{},{:.6f},{}]'.format(i, i / 7, -i * 1000003) for i in range(scale * 1000)) + ']', (None, None)
+
+
+def gen_sparse(scale):
+    # few matches at the end of a large document
+    payload = ','.join('{{"id":{},"tags":["a","b"],"nested":{{"x":[1,2,3]}}}}'.format(i) for i in range(scale * 1000))
+    return '{"payload":[' + payload + '],"matches":[1,2,3]}', ('matches', None)
+
+
+# name -> generator of JSON text and pattern by scale
+SHAPES = {
+    'flat': gen_flat,
+    'deep': gen_deep,
+    'wide': gen_wide,
+    'long_strings': gen_long_strings,
+    'escaped_strings': gen_escaped_strings,
+    'numbers': gen_numbers,
+    'sparse': gen_sparse,
+}
+
+PATH_MODES = ['ignore', 'map_keys', 'full']
+
+READ_SIZES = ['1024', '65536', '1048576', 'auto']
+
+INPUTS = ['bytes', 'str', 'path', 'fd']
+
+
+class Input:
+    """Provides parser input of given type over a temporary file."""
+
+    def __init__(self, data, tmpdir):
+        self.text = data
+        self.data = data.encode('utf-8')
+        self.path = os.path.join(tmpdir, 'input.json')
+        with open(self.path, 'wb') as fd:
+            fd.write(self.data)
+
+    def open(self, kind):
+        if kind == 'bytes':
+            return io.BytesIO(self.data)
+        elif kind == 'str':
+            return io.StringIO(self.text)
+        elif kind == 'path':
+            return self.path
+        elif kind == 'fd':
+            return os.open(self.path, os.O_RDONLY)
+        raise ValueError(kind)
+
+    def close(self, kind, source):
+        if kind == 'fd':
+            os.close(source)
+
+
+def parse_read_size(value):
+    return value if value == 'auto' else int(value)
+
+
+def measure(input_, kind, pattern, path_mode, read_size, repeat):
+    best = None
+    objects = 0
+    for _ in range(repeat):
+        source = input_.open(kind)
+        try:
+            start = time.perf_counter()
+            objects = sum(1 for _ in JsonSlicer(source, pattern, path_mode=path_mode, read_size=parse_read_size(read_size)))
+            elapsed = time.perf_counter() - start
+        finally:
+            input_.close(kind, source)
+        best = elapsed if best is None else min(best, elapsed)
+    return best, objects
+
+
+def result_key(result):
+    return '{shape}/{path_mode}/{read_size}/{input}'.format(**result)
+
+
+def run(args):
+    results = []
+
+    with tempfile.TemporaryDirectory() as tmpdir:
+        for shape in args.shapes:
+            text, pattern = SHAPES[shape](args.scale)
+            input_ = Input(text, tmpdir)
+            size = len(input_.data)
+
+            for path_mode, read_size, kind in itertools.product(args.path_modes, args.read_sizes, args.inputs):
+                elapsed, objects = measure(input_, kind, pattern, path_mode, read_size, args.repeat)
+                result = {
+                    'shape': shape,
+                    'path_mode': path_mode,
+                    'read_size': read_size,
+                    'input': kind,
+                    'bytes': size,
+                    'objects': objects,
+                    'seconds': elapsed,
+                    'mb_per_s': size / elapsed / 1000000,
+                    'objects_per_s': objects / elapsed,
+                }
+                results.append(result)
+                if args.verbose:
+                    print('{}: {:.1f} MB/s'.format(result_key(result), result['mb_per_s']), file=sys.stderr)
+
+    return results
+
+
+def compare(results, baseline, threshold):
+    baseline_results = {result_key(result): result for result in baseline['results']}
+
+    regressions = []
+    for result in results:
+        base = baseline_results.get(result_key(result))
+        if base is None:
+            result['change'] = None
+            continue
+        result['change'] = result['mb_per_s'] / base['mb_per_s'] - 1
+        if result['change'] < -threshold:
+            regressions.append(result)
+
+    return regressions
+
+
+def print_rows(headers, rows):
+    widths = [max(len(row[i]) for row in [headers] + rows) for i in range(len(headers))]
+    for row in [headers] + rows:
+        print(' | '.join(cell.ljust(width) if i == 0 else cell.rjust(width) for i, (cell, width) in enumerate(zip(row, widths))))
+
+
+def print_table(results):
+    print_rows(
+        ['Case', 'MB/s', 'Objects/s', 'Change'],
+        [
+            [
+                result_key(result),
+                '{:.1f}'.format(result['mb_per_s']),
+                '{:.1f}K'.format(result['objects_per_s'] / 1000),
+                '' if result.get('change') is None else '{:+.1%}'.format(result['change']),
+            ]
+            for result in results
+        ]
+    )
+
+
+# arguments and results handling shared with benchmark_memory.py
+
+def add_common_arguments(parser, threshold_help):
+    parser.add_argument('-s', '--scale', type=int, default=10, help='size of generated documents (10 is about 1-3 MB each)')
+    parser.add_argument('--shapes', nargs='+', choices=list(SHAPES), default=list(SHAPES), help='data shapes to test')
+    parser.add_argument('--path-modes', nargs='+', choices=PATH_MODES, default=PATH_MODES, help='path modes to test')
+    parser.add_argument('--read-sizes', nargs='+', default=READ_SIZES, help='read sizes to test')
+    parser.add_argument('-o', '--output', help='save results into JSON file')
+    parser.add_argument('-b', '--baseline', help='compare results with ones saved into JSON file')
+    parser.add_argument('-t', '--threshold', type=float, default=0.1, help=threshold_help)
+    parser.add_argument('-v', '--verbose', action='store_true', help='report progress')
+
+
+def check_common_arguments(parser, args):
+    """Validates common arguments, and returns loaded baseline, if any."""
+    for read_size in args.read_sizes:
+        if read_size != 'auto' and not read_size.isdigit():
+            parser.error('bad read size: {}'.format(read_size))
+
+    # results for differently sized documents are not comparable
+    baseline = None
+    if args.baseline:
+        with open(args.baseline) as fd:
+            baseline = json.load(fd)
+        if baseline.get('scale') != args.scale:
+            parser.error('baseline was made with scale {}, not {}'.format(baseline.get('scale'), args.scale))
+
+    return baseline
+
+
+def save_results(args, results):
+    with open(args.output, 'w') as fd:
+        json.dump({
+            'python': platform.python_version(),
+            'platform': platform.platform(),
+            'scale': args.scale,
+            'results': results,
+        }, fd, indent=1)
+
+
+def main():
+    parser = argparse.ArgumentParser(formatter_class=argparse.ArgumentDefaultsHelpFormatter)
+    add_common_arguments(parser, threshold_help='relative throughput loss reported as regression')
+    parser.add_argument('-r', '--repeat', type=int, default=3, help='number of runs of each case, the best is taken')
+    parser.add_argument('--inputs', nargs='+', choices=INPUTS, default=INPUTS, help='input types to test')
+    args = parser.parse_args()
+
+    baseline = check_common_arguments(parser, args)
+
+    results = run(args)
+
+    regressions = []
+    if baseline:
+        regressions = compare(results, baseline, args.threshold)
+
+    print_table(results)
+
+    if args.output:
+        save_results(args, results)
+
+    if regressions:
+        print('\n{} regression(s) over {:.0%} threshold:'.format(len(regressions), args.threshold))
+        for result in regressions:
+            print('  {}: {:+.1%}'.format(result_key(result), result['change']))
+        return 1
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,249 @@
+#!/usr/bin/env python3
+
+# Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+
+"""Memory benchmark over a matrix of data shapes and parser options.
+
+Each case is run in a separate process, so its allocations are not
+affected by other cases. A child process inherits peak RSS of the
+parent, so it's reset at the start of each case; this is only
+supported on Linux, elsewhere RSS growth is reported as 0. For each
+case, the input is parsed twice:
+
+- streaming, with objects discarded as soon as they are returned,
+  which gives peak RSS growth, tracemalloc peak, peak number of live
+  allocated blocks, and peak length of parser output queue; memory
+  use here should not depend on input size
+- retaining all objects, which gives memory overhead per object
+
+Results may be saved as JSON; with a saved baseline, cases where any
+of the metrics grew by more than the threshold are reported as
+regressions, and the exit status is nonzero.
+
+    ./benchmark_memory.py --output baseline.json
+    ./benchmark_memory.py --baseline baseline.json --threshold 0.1
+"""
+
+import argparse
+import gc
+import itertools
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import tracemalloc
+
+from benchmark_matrix import SHAPES, add_common_arguments, check_common_arguments, parse_read_size, print_rows, save_results
+from jsonslicer import JsonSlicer
+
+# metrics compared against baseline, with absolute slack which
+# prevents tiny values from being reported
+METRICS = {
+    'rss_growth_kb': 1024,
+    'tracemalloc_peak_per_mb': 4096,
+    'blocks_per_mb': 16,
+    'bytes_per_object': 8,
+    'peak_complete': 4,
+}
+
+
+def reset_peak_rss():
+    """Resets peak RSS to current RSS; returns whether it's supported."""
+    try:
+        with open('/proc/self/clear_refs', 'w') as fd:
+            fd.write('5')
+        return True
+    except OSError:
+        return False
+
+
+def peak_rss_kb():
+    with open('/proc/self/status') as fd:
+        for line in fd:
+            if line.startswith('VmHWM:'):
+                return int(line.split()[1])
+    raise RuntimeError('VmHWM not found in /proc/self/status')
+
+
+def run_case(case):
+    """Measures a single case, in a child process."""
+    pattern = tuple(case['pattern'])
+    read_size = parse_read_size(case['read_size'])
+    size_mb = case['bytes'] / 1000000
+
+    def make_parser(fd):
+        return JsonSlicer(fd, pattern, path_mode=case['path_mode'], read_size=read_size)
+
+    gc.collect()
+    rss_supported = reset_peak_rss()
+    rss_before = peak_rss_kb() if rss_supported else 0
+
+    # streaming
+    fd = os.open(case['path'], os.O_RDONLY)
+    tracemalloc.start()
+    blocks_before = sys.getallocatedblocks()
+    blocks_peak = 0
+    objects = 0
+    parser = make_parser(fd)
+    for _ in parser:
+        objects += 1
+        if objects % 64 == 0:
+            blocks_peak = max(blocks_peak, sys.getallocatedblocks() - blocks_before)
+    blocks_peak = max(blocks_peak, sys.getallocatedblocks() - blocks_before)
+    _, tracemalloc_peak = tracemalloc.get_traced_memory()
+    tracemalloc.stop()
+    peak_complete = parser.stats['peak_complete']
+    del parser
+    os.close(fd)
+
+    rss_growth = peak_rss_kb() - rss_before if rss_supported else 0
+
+    # retaining
+    fd = os.open(case['path'], os.O_RDONLY)
+    gc.collect()
+    tracemalloc.start()
+    objects_list = list(make_parser(fd))
+    retained, _ = tracemalloc.get_traced_memory()
+    tracemalloc.stop()
+    del objects_list
+    os.close(fd)
+
+    return {
+        'objects': objects,
+        'rss_growth_kb': rss_growth,
+        'tracemalloc_peak': tracemalloc_peak,
+        'tracemalloc_peak_per_mb': tracemalloc_peak / size_mb,
+        'blocks_per_mb': blocks_peak / size_mb,
+        'bytes_per_object': retained / objects if objects else 0,
+        'peak_complete': peak_complete,
+    }
+
+
+def result_key(result):
+    return '{shape}/{path_mode}/{read_size}'.format(**result)
+
+
+def run(args):
+    results = []
+
+    with tempfile.TemporaryDirectory() as tmpdir:
+        for shape in args.shapes:
+            text, pattern = SHAPES[shape](args.scale)
+            path = os.path.join(tmpdir, shape + '.json')
+            with open(path, 'w', encoding='utf-8') as fd:
+                fd.write(text)
+            size = os.path.getsize(path)
+            del text
+
+            for path_mode, read_size in itertools.product(args.path_modes, args.read_sizes):
+                case = {
+                    'shape': shape,
+                    'path_mode': path_mode,
+                    'read_size': read_size,
+                    'pattern': pattern,
+                    'path': path,
+                    'bytes': size,
+                }
+
+                output = subprocess.run(
+                    [sys.executable, os.path.abspath(__file__), '--run-case', json.dumps(case)],
+                    stdout=subprocess.PIPE,
+                    check=True,
+                ).stdout
+
+                del case['pattern']
+                del case['path']
+                result = dict(case, **json.loads(output.decode('utf-8')))
+                results.append(result)
+
+                if args.verbose:
+                    print('{}: {:.0f} bytes/object'.format(result_key(result), result['bytes_per_object']), file=sys.stderr)
+
+    return results
+
+
+def compare(results, baseline, threshold):
+    baseline_results = {result_key(result): result for result in baseline['results']}
+
+    regressions = []
+    for result in results:
+        base = baseline_results.get(result_key(result))
+        if base is None:
+            continue
+        for metric, slack in METRICS.items():
+            if result[metric] > base[metric] * (1 + threshold) + slack:
+                regressions.append((result_key(result), metric, base[metric], result[metric]))
+
+    return regressions
+
+
+def print_table(results):
+    print_rows(
+        ['Case', 'RSS growth KB', 'Peak KB/MB', 'Blocks/MB', 'Bytes/object', 'Peak queue'],
+        [
+            [
+                result_key(result),
+                '{}'.format(result['rss_growth_kb']),
+                '{:.1f}'.format(result['tracemalloc_peak_per_mb'] / 1024),
+                '{:.0f}'.format(result['blocks_per_mb']),
+                '{:.0f}'.format(result['bytes_per_object']),
+                '{}'.format(result['peak_complete']),
+            ]
+            for result in results
+        ]
+    )
+
+
+def main():
+    parser = argparse.ArgumentParser(formatter_class=argparse.ArgumentDefaultsHelpFormatter)
+    add_common_arguments(parser, threshold_help='relative growth of a metric reported as regression')
+    parser.add_argument('--run-case', help=argparse.SUPPRESS)
+    args = parser.parse_args()
+
+    if args.run_case:
+        json.dump(run_case(json.loads(args.run_case)), sys.stdout)
+        return 0
+
+    baseline = check_common_arguments(parser, args)
+
+    results = run(args)
+
+    regressions = []
+    if baseline:
+        regressions = compare(results, baseline, args.threshold)
+
+    print_table(results)
+
+    if args.output:
+        save_results(args, results)
+
+    if regressions:
+        print('\n{} regression(s) over {:.0%} threshold:'.format(len(regressions), args.threshold))
+        for key, metric, before, after in regressions:
+            print('  {} {}: {:.0f} -> {:.0f}'.format(key, metric, before, after))
+        return 1
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -1,10 +1,13 @@
-from typing import Any, IO, Iterator, Tuple, Union
+import os
+from typing import Any, Dict, IO, Iterable, Iterator, List, Tuple, Union
+
+ANY_DEPTH: ellipsis
 
 class JsonSlicer:
     def __init__(self,
-                 file: IO,
-                 path_prefix: Tuple[Union[str, bytes, None], ...],
-                 read_size: int=...,
+                 file: Union[IO, str, bytes, os.PathLike, int],
+                 path_prefix: Union[Tuple[Union[str, bytes, int, None, ellipsis], ...], List[Tuple[Union[str, bytes, int, None, ellipsis], ...]]],
+                 read_size: Union[int, str]=...,
                  path_mode: str=...,
                  yajl_allow_comments: bool=...,
                  yajl_dont_validate_strings: bool=...,
@@ -13,8 +16,42 @@ class JsonSlicer:
                  yajl_allow_partial_values: bool=...,
                  encoding: Union[None, str]=...,
                  errors: Union[None, str]=...,
-                 binary: bool=...) -> None: ...
+                 binary: bool=...,
+                 fast_skip: bool=...,
+                 pipelined: bool=...,
+                 intern_values: bool=...,
+                 fields: Union[None, Iterable[Union[str, bytes, int, None, Tuple[Union[str, bytes, int, None], ...]]]]=...,
+                 where: Union[None, Iterable[Tuple[Any, ...]]]=...,
+                 output: str=...,
+                 threads: int=...,
+                 checkpoints: bool=...,
+                 timing: bool=...) -> None: ...
+
+    @property
+    def stats(self) -> Dict[str, Any]: ...
 
     def __iter__(self) -> Iterator[Any]: ...
 
     def __next__(self) -> Any: ...
+
+    def next_batch(self, n: int) -> List[Any]: ...
+
+    def collect(self) -> List[Any]: ...
+
+    def aggregate(self,
+                  *,
+                  count: bool=...,
+                  sum: Any=...,
+                  min: Any=...,
+                  max: Any=...,
+                  group_by: Any=...) -> Dict[Any, Any]: ...
+
+    def dump_ndjson(self, file: Union[IO, str, bytes, os.PathLike, int]) -> Dict[str, int]: ...
+
+    def build_index(self, file: Union[IO, str, bytes, os.PathLike, int], *, every: int=...) -> Dict[str, int]: ...
+
+    def seek(self, match: int, file: Union[IO, str, bytes, os.PathLike, int]) -> None: ...
+
+    def checkpoint(self) -> bytes: ...
+
+    def resume(self, checkpoint: bytes) -> None: ...
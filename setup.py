@@ -79,27 +79,39 @@ setup(
             extra_compile_args=[
                 '-std=c++11',
                 '-DJSONSLICER_VERSION=\"{}\"'.format(version),
-                # JsonSlicer can operate in two modes, either storing paths
-                # in binary or in unicode form internally. The former is
-                # slightly faster since we need to compare bytes instead of
-                # unicode, both seem to be correct, but I'm leaving the toggle
-                # here if some edge cases are discovered.
-                '-DUSE_BYTES_INTERNALLY',
                 '-fno-exceptions',
                 '-fno-rtti',
+                '-pthread',
+            ],
+            extra_link_args=[
+                '-pthread',
             ],
             sources=[
+                'src/aggregator.cc',
+                'src/array_splitter.cc',
                 'src/construct_handlers.cc',
                 'src/encoding.cc',
+                'src/filter.cc',
                 'src/handlers.cc',
+                'src/input.cc',
                 'src/jsonslicer_construction.cc',
                 'src/jsonslicer_iteration.cc',
                 'src/jsonslicer_type.cc',
+                'src/key_cache.cc',
+                'src/matcher.cc',
+                'src/offset_index.cc',
                 'src/output_formatting.cc',
+                'src/output_sink.cc',
+                'src/parallel_parser.cc',
+                'src/path.cc',
+                'src/pattern.cc',
+                'src/pipeline.cc',
+                'src/projection.cc',
                 'src/py_module.cc',
-                'src/pymutindex.cc',
-                'src/pyobjlist.cc',
+                'src/read_size_tuner.cc',
                 'src/seek_handlers.cc',
+                'src/skip_scanner.cc',
+                'src/stats.cc',
             ],
             **pkgconfig_yajl()
         )
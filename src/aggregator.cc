@@ -0,0 +1,276 @@
+/*
+ * Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "aggregator.hh"
+
+#include <Python.h>
+
+#include <cstring>
+
+void Aggregator::Accumulator::add_sum(const Filter::Value& value) {
+	if (value.type == Filter::Value::Type::INTEGER) {
+		long long result;
+		if (sum_is_integer && __builtin_add_overflow(integer_sum, value.integer, &result)) {
+			// switch to floating point on overflow
+			sum_is_integer = false;
+			real_sum = static_cast<double>(integer_sum) + static_cast<double>(value.integer);
+		} else if (sum_is_integer) {
+			integer_sum = result;
+		} else {
+			real_sum += static_cast<double>(value.integer);
+		}
+	} else if (value.type == Filter::Value::Type::DOUBLE) {
+		if (sum_is_integer) {
+			sum_is_integer = false;
+			real_sum = static_cast<double>(integer_sum);
+		}
+		real_sum += value.real;
+	} else {
+		return;
+	}
+	sum_count++;
+}
+
+static bool is_number(const Filter::Value& value) {
+	return value.type == Filter::Value::Type::INTEGER || value.type == Filter::Value::Type::DOUBLE;
+}
+
+static double as_double(const Filter::Value& value) {
+	return value.type == Filter::Value::Type::INTEGER ? static_cast<double>(value.integer) : value.real;
+}
+
+static bool less(const Filter::Value& a, const Filter::Value& b) {
+	if (a.type == Filter::Value::Type::INTEGER && b.type == Filter::Value::Type::INTEGER) {
+		return a.integer < b.integer;
+	}
+	return as_double(a) < as_double(b);
+}
+
+void Aggregator::Accumulator::add_min(const Filter::Value& value) {
+	if (is_number(value) && (!has_min || less(value, min))) {
+		min = value;
+		has_min = true;
+	}
+}
+
+void Aggregator::Accumulator::add_max(const Filter::Value& value) {
+	if (is_number(value) && (!has_max || less(max, value))) {
+		max = value;
+		has_max = true;
+	}
+}
+
+bool Aggregator::compile_field(PyObject* field, PyObjPtr encoding, PyObjPtr errors, Filter& filter, const char* what, int* index) {
+	*index = -1;
+	if (field == nullptr || field == Py_None) {
+		return true;
+	}
+
+	// single path element is a shortcut for a path of length 1
+	PyObjPtr path;
+	if (PyUnicode_Check(field) || PyBytes_Check(field) || PyLong_Check(field)) {
+		path = PyObjPtr::Take(PyTuple_Pack(1, field));
+	} else {
+		path = PyObjPtr::Borrow(field);
+	}
+	if (!path) {
+		return false;
+	}
+
+	Pattern pattern;
+	if (!pattern.compile(path.get(), encoding, errors, what)) {
+		return false;
+	}
+	if (pattern.has_any_depth()) {
+		PyErr_Format(PyExc_ValueError, "Recursive wildcard is not supported in %s", what);
+		return false;
+	}
+
+	*index = filter.add_capture(pattern);
+	if (*index == -1) {
+		PyErr_SetString(PyExc_ValueError, "Too many where conditions and aggregated fields");
+		return false;
+	}
+	return true;
+}
+
+bool Aggregator::compile(bool count, PyObject* sum, PyObject* min, PyObject* max, PyObject* group_by, PyObjPtr encoding, PyObjPtr errors, Filter& filter) {
+	if (!compile_field(sum, encoding, errors, filter, "sum", &sum_) ||
+			!compile_field(min, encoding, errors, filter, "min", &min_) ||
+			!compile_field(max, encoding, errors, filter, "max", &max_) ||
+			!compile_field(group_by, encoding, errors, filter, "group_by", &group_by_)) {
+		return false;
+	}
+
+	count_ = count;
+	active_ = true;
+	return true;
+}
+
+// Group values are encoded into strings with type tag, and booleans
+// and integral doubles are merged with integers, just like python dict
+// would do
+Aggregator::Accumulator& Aggregator::get_group(const Filter::Value* value) {
+	group_key_.clear();
+	if (value == nullptr) {
+		group_key_ = "n";
+	} else {
+		switch (value->type) {
+		case Filter::Value::Type::BOOLEAN: {
+			long long integer = value->boolean ? 1 : 0;
+			group_key_ = "i";
+			group_key_.append(reinterpret_cast<const char*>(&integer), sizeof(integer));
+			break;
+		}
+		case Filter::Value::Type::INTEGER:
+			group_key_ = "i";
+			group_key_.append(reinterpret_cast<const char*>(&value->integer), sizeof(value->integer));
+			break;
+		case Filter::Value::Type::DOUBLE:
+			if (value->real >= -9.2e18 && value->real <= 9.2e18 && static_cast<double>(static_cast<long long>(value->real)) == value->real) {
+				long long integer = static_cast<long long>(value->real);
+				group_key_ = "i";
+				group_key_.append(reinterpret_cast<const char*>(&integer), sizeof(integer));
+			} else {
+				group_key_ = "d";
+				group_key_.append(reinterpret_cast<const char*>(&value->real), sizeof(value->real));
+			}
+			break;
+		case Filter::Value::Type::STRING:
+			group_key_ = "s";
+			group_key_.append(value->data, value->len);
+			break;
+		case Filter::Value::Type::NUL:
+		case Filter::Value::Type::CONTAINER:
+			group_key_ = "n";
+			break;
+		}
+	}
+
+	auto found = group_index_.find(group_key_);
+	if (found != group_index_.end()) {
+		return groups_[found->second].second;
+	}
+
+	group_index_.emplace(group_key_, groups_.size());
+	groups_.emplace_back(group_key_, Accumulator());
+	return groups_.back().second;
+}
+
+void Aggregator::add(const Filter& filter) {
+	Accumulator& accumulator = group_by_ == -1 ? total_ : get_group(filter.captured(group_by_));
+
+	accumulator.count++;
+
+	const Filter::Value* value;
+	if (sum_ != -1 && (value = filter.captured(sum_)) != nullptr) {
+		accumulator.add_sum(*value);
+	}
+	if (min_ != -1 && (value = filter.captured(min_)) != nullptr) {
+		accumulator.add_min(*value);
+	}
+	if (max_ != -1 && (value = filter.captured(max_)) != nullptr) {
+		accumulator.add_max(*value);
+	}
+}
+
+static PyObjPtr make_number(const Filter::Value& value) {
+	if (value.type == Filter::Value::Type::INTEGER) {
+		return PyObjPtr::Take(PyLong_FromLongLong(value.integer));
+	} else {
+		return PyObjPtr::Take(PyFloat_FromDouble(value.real));
+	}
+}
+
+static bool set_item(PyObjPtr dict, const char* key, PyObjPtr value) {
+	return value && PyDict_SetItemString(dict.get(), key, value.get()) == 0;
+}
+
+PyObjPtr Aggregator::make_result(const Accumulator& accumulator) const {
+	PyObjPtr result = PyObjPtr::Take(PyDict_New());
+	if (!result) {
+		return {};
+	}
+
+	if (count_ && !set_item(result, "count", PyObjPtr::Take(PyLong_FromSize_t(accumulator.count)))) {
+		return {};
+	}
+	if (sum_ != -1) {
+		PyObjPtr sum = accumulator.sum_is_integer ? PyObjPtr::Take(PyLong_FromLongLong(accumulator.integer_sum)) : PyObjPtr::Take(PyFloat_FromDouble(accumulator.real_sum));
+		if (!set_item(result, "sum", sum)) {
+			return {};
+		}
+	}
+	if (min_ != -1 && !set_item(result, "min", accumulator.has_min ? make_number(accumulator.min) : PyObjPtr::Borrow(Py_None))) {
+		return {};
+	}
+	if (max_ != -1 && !set_item(result, "max", accumulator.has_max ? make_number(accumulator.max) : PyObjPtr::Borrow(Py_None))) {
+		return {};
+	}
+
+	return result;
+}
+
+PyObjPtr Aggregator::make_group_key(const std::string& key, const Decoder& decoder) {
+	switch (key[0]) {
+	case 'i': {
+		long long integer;
+		std::memcpy(&integer, key.data() + 1, sizeof(integer));
+		return PyObjPtr::Take(PyLong_FromLongLong(integer));
+	}
+	case 'd': {
+		double real;
+		std::memcpy(&real, key.data() + 1, sizeof(real));
+		return PyObjPtr::Take(PyFloat_FromDouble(real));
+	}
+	case 's':
+		return decoder.decode(key.data() + 1, key.size() - 1);
+	default:
+		return PyObjPtr::Borrow(Py_None);
+	}
+}
+
+PyObjPtr Aggregator::result(const Decoder& decoder) const {
+	if (group_by_ == -1) {
+		return make_result(total_);
+	}
+
+	PyObjPtr result = PyObjPtr::Take(PyDict_New());
+	if (!result) {
+		return {};
+	}
+
+	for (const auto& group: groups_) {
+		PyObjPtr key = make_group_key(group.first, decoder);
+		if (!key) {
+			return {};
+		}
+		PyObjPtr value = make_result(group.second);
+		if (!value) {
+			return {};
+		}
+		if (PyDict_SetItem(result.get(), key.get(), value.get()) != 0) {
+			return {};
+		}
+	}
+
+	return result;
+}
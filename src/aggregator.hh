@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef JSONSLICER_AGGREGATOR_HH
+#define JSONSLICER_AGGREGATOR_HH
+
+#include "encoding.hh"
+#include "filter.hh"
+#include "pyobjptr.hh"
+
+#include <Python.h>
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Native accumulators for aggregate() method: count of matched
+// objects, and sum, min and max of numeric fields in them, optionally
+// grouped by value of another field. Fields are captured by the filter,
+// which tracks relative paths in matched objects anyway, so objects
+// themselves are never constructed.
+class Aggregator {
+private:
+	struct Accumulator {
+		size_t count = 0;
+
+		size_t sum_count = 0;
+		bool sum_is_integer = true;
+		long long integer_sum = 0;
+		double real_sum = 0.0;
+
+		bool has_min = false;
+		Filter::Value min{Filter::Value::Type::NUL};
+		bool has_max = false;
+		Filter::Value max{Filter::Value::Type::NUL};
+
+		void add_sum(const Filter::Value& value);
+		void add_min(const Filter::Value& value);
+		void add_max(const Filter::Value& value);
+	};
+
+private:
+	bool active_ = false;
+	bool count_ = false;
+
+	// indexes of filter capture conditions, -1 if not requested
+	int sum_ = -1;
+	int min_ = -1;
+	int max_ = -1;
+	int group_by_ = -1;
+
+	Accumulator total_;
+
+	// groups in order of appearance, keyed by encoded group value
+	std::vector<std::pair<std::string, Accumulator>> groups_;
+	std::unordered_map<std::string, size_t> group_index_;
+	std::string group_key_;
+
+private:
+	static bool compile_field(PyObject* field, PyObjPtr encoding, PyObjPtr errors, Filter& filter, const char* what, int* index);
+
+	Accumulator& get_group(const Filter::Value* value);
+
+	PyObjPtr make_result(const Accumulator& accumulator) const;
+	static PyObjPtr make_group_key(const std::string& key, const Decoder& decoder);
+
+public:
+	// sets up aggregation, registering fields with the filter; each
+	// field is a field name or a sequence of path elements relative
+	// to the matched object, or None if not needed
+	bool compile(bool count, PyObject* sum, PyObject* min, PyObject* max, PyObject* group_by, PyObjPtr encoding, PyObjPtr errors, Filter& filter);
+
+	bool active() const {
+		return active_;
+	}
+
+	// whether no fields are needed
+	bool count_only() const {
+		return sum_ == -1 && min_ == -1 && max_ == -1 && group_by_ == -1;
+	}
+
+	// accounts matched object which passed the filter
+	void add(const Filter& filter);
+
+	// dict with requested aggregates, or dict of such dicts keyed by
+	// group value
+	PyObjPtr result(const Decoder& decoder) const;
+};
+
+#endif
@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "array_splitter.hh"
+
+#include "matcher.hh"
+
+#include <algorithm>
+
+static bool is_whitespace(unsigned char c) {
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+void ArraySplitter::reset(const unsigned char* data, size_t size, bool split) {
+	data_ = data;
+	size_ = size;
+	pos_ = 0;
+	array_begin_ = 0;
+	enclosing_maps_ = 0;
+	split_ = split;
+	done_ = false;
+}
+
+size_t ArraySplitter::skip_whitespace(size_t pos) const {
+	while (pos < size_ && is_whitespace(data_[pos])) {
+		pos++;
+	}
+	return pos;
+}
+
+// moves pos from the opening quote to right after the closing one
+bool ArraySplitter::skip_string(size_t* pos, bool* escaped) const {
+	*escaped = false;
+	for (size_t i = *pos + 1; i < size_; i++) {
+		if (data_[i] == '\\') {
+			*escaped = true;
+			i++;
+		} else if (data_[i] == '"') {
+			*pos = i + 1;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool ArraySplitter::skip_value(size_t* pos) {
+	if (*pos == size_) {
+		return false;
+	}
+
+	bool escaped;
+	switch (data_[*pos]) {
+	case '{':
+	case '[': {
+		size_t scanned;
+		scanner_.start();
+		if (!scanner_.scan(data_ + *pos + 1, size_ - *pos - 1, &scanned)) {
+			return false;
+		}
+		*pos += 1 + scanned;
+		return true;
+	}
+	case '"':
+		return skip_string(pos, &escaped);
+	default:
+		while (*pos < size_ && !is_whitespace(data_[*pos]) && data_[*pos] != ',' && data_[*pos] != '}' && data_[*pos] != ']') {
+			(*pos)++;
+		}
+		return true;
+	}
+}
+
+// Descends into the first member of each map which may contain
+// matches, or is a matched array. The rest of the text, including
+// members which are skipped here, is still parsed as a whole, so
+// finding the array only has to be right for valid input, and it
+// gives up on anything unexpected, such as escaped keys, which would
+// have to be decoded to be matched.
+bool ArraySplitter::find_array(Matcher& matcher) {
+	int state = matcher.root();
+	size_t pos = skip_whitespace(0);
+	while (pos < size_ && data_[pos] == '{') {
+		pos = skip_whitespace(pos + 1);
+		while (true) {
+			size_t key_begin = pos + 1;
+			bool escaped;
+			if (pos == size_ || data_[pos] != '"' || !skip_string(&pos, &escaped) || escaped) {
+				return false;
+			}
+			int value_state = matcher.select_key(state, reinterpret_cast<const char*>(data_ + key_begin), pos - 1 - key_begin);
+
+			pos = skip_whitespace(pos);
+			if (pos == size_ || data_[pos] != ':') {
+				return false;
+			}
+			pos = skip_whitespace(pos + 1);
+
+			if (pos < size_ && ((data_[pos] == '{' && matcher.descends(value_state)) || (data_[pos] == '[' && (matcher.descends(value_state) || matcher.matches(value_state))))) {
+				state = value_state;
+				enclosing_maps_++;
+				break;
+			}
+
+			if (!skip_value(&pos)) {
+				return false;
+			}
+			pos = skip_whitespace(pos);
+			if (pos == size_ || data_[pos] != ',') {
+				return false;  // end of map, nothing to split in it
+			}
+			pos = skip_whitespace(pos + 1);
+		}
+	}
+
+	if (pos == size_ || data_[pos] != '[') {
+		return false;
+	}
+
+	array_begin_ = pos + 1;
+	return true;
+}
+
+bool ArraySplitter::locate(Matcher& matcher) {
+	if (split_ && !find_array(matcher)) {
+		split_ = false;
+		array_begin_ = 0;
+		enclosing_maps_ = 0;
+	}
+	return split_;
+}
+
+// comma must separate non-empty elements, otherwise an error would
+// pass unnoticed, as both segments are wrapped into arrays
+bool ArraySplitter::can_split_at(size_t pos) const {
+	size_t prev = pos;
+	while (prev > 0 && is_whitespace(data_[prev - 1])) {
+		prev--;
+	}
+	if (prev == 0 || data_[prev - 1] == '[' || data_[prev - 1] == ',') {
+		return false;
+	}
+
+	size_t next = pos + 1;
+	while (next < size_ && is_whitespace(data_[next])) {
+		next++;
+	}
+	return next < size_ && data_[next] != ']' && data_[next] != ',';
+}
+
+void ArraySplitter::next(size_t min_size, size_t* begin, size_t* end) {
+	*begin = pos_;
+	*end = size_;
+
+	if (done_) {
+		return;
+	}
+	if (!split_) {
+		done_ = true;
+		return;
+	}
+
+	size_t pos = pos_;
+	if (pos == 0) {
+		if (array_begin_ == 0) {
+			done_ = true;
+			return;
+		}
+		scanner_.start();
+		pos = array_begin_;
+	}
+
+	while (pos < size_) {
+		size_t scanned;
+
+		// skip the bulk of the segment
+		size_t min_end = std::min(*begin + min_size, size_);
+		if (pos < min_end) {
+			if (scanner_.scan(data_ + pos, min_end - pos, &scanned)) {
+				break;  // end of array
+			}
+			pos = min_end;
+		}
+
+		// find the nearest separator
+		if (!scanner_.scan_to_comma(data_ + pos, size_ - pos, &scanned) || !scanner_.active()) {
+			break;  // end of data or array
+		}
+		pos += scanned;
+
+		if (can_split_at(pos)) {
+			*end = pos;
+			pos_ = pos + 1;
+			return;
+		}
+		pos++;
+	}
+
+	done_ = true;
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef JSONSLICER_ARRAY_SPLITTER_HH
+#define JSONSLICER_ARRAY_SPLITTER_HH
+
+#include "skip_scanner.hh"
+
+#include <cstddef>
+
+class Matcher;
+
+// Splits an array in JSON text into segments at element boundaries,
+// so they can be parsed independently. The array is either the top
+// level value, or is found inside top level object by following map
+// keys which may lead to matches. Only structure is tracked (with
+// SkipScanner, which skips the bulk of each segment), and nothing is
+// validated here: segments joined with commas give the original text
+// back, so the parser finds any errors in them, as long as no segment
+// is empty.
+//
+// Segments are separated by commas, which are not included into
+// either of them. The first segment includes everything up to the
+// opening bracket of the array, and the last one includes the closing
+// bracket and anything after it.
+class ArraySplitter {
+private:
+	const unsigned char* data_ = nullptr;
+	size_t size_ = 0;
+	size_t pos_ = 0;  // start of next segment
+	size_t array_begin_ = 0;  // right after opening bracket
+	size_t enclosing_maps_ = 0;
+	bool split_ = false;
+	bool done_ = true;
+
+	SkipScanner scanner_;
+
+private:
+	size_t skip_whitespace(size_t pos) const;
+	bool skip_string(size_t* pos, bool* escaped) const;
+	bool skip_value(size_t* pos);
+	bool find_array(Matcher& matcher);
+	bool can_split_at(size_t pos) const;
+
+public:
+	// without split, the whole text is returned as a single segment
+	void reset(const unsigned char* data, size_t size, bool split = true);
+
+	// finds the array to split, and returns whether there's one; the
+	// whole text is returned as a single segment otherwise
+	bool locate(Matcher& matcher);
+
+	// number of maps the array is nested in
+	size_t enclosing_maps() const {
+		return enclosing_maps_;
+	}
+
+	// whether the last segment was returned
+	bool done() const {
+		return done_;
+	}
+
+	// returns the next segment, which is at least min_size bytes long
+	// unless it's the last one
+	void next(size_t min_size, size_t* begin, size_t* end);
+};
+
+#endif
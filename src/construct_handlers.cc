@@ -24,15 +24,15 @@
 
 #include "seek_handlers.hh"
 
-#include "pyobjlist.hh"
-
 #include <Python.h>
 
 #include <assert.h>
 
+#include <string>
+
 // helpers
 bool add_to_parent(JsonSlicer* self, PyObjPtr value) {
-	PyObjPtr container = self->constructing.back();
+	const PyObjPtr& container = self->constructing.back();
 
 	if (PyDict_Check(container.get())) {
 		if (!PyBytes_Check(self->last_map_key.get()) && !PyUnicode_Check(self->last_map_key.get())) {
@@ -54,3 +54,73 @@ bool add_to_parent(JsonSlicer* self, PyObjPtr value) {
 
 	return true;
 }
+
+PyObjPtr make_map_key(JsonSlicer* self, const char* data, size_t len) {
+	return self->key_cache.get(data, len, [self, data, len]{
+		return self->decoder.decode(data, len);
+	});
+}
+
+PyObjPtr make_number(const char* data, size_t len) {
+	// python number parsers need zero terminated string
+	std::string number(data, len);
+	if (number.find_first_of(".eE") == std::string::npos) {
+		return PyObjPtr::Take(PyLong_FromString(number.c_str(), nullptr, 10));
+	}
+
+	PyObjPtr str = PyObjPtr::Take(PyUnicode_FromStringAndSize(data, len));
+	if (!str) {
+		return {};
+	}
+	return PyObjPtr::Take(PyFloat_FromString(str.get()));
+}
+
+bool check_gen_status(yajl_gen_status status) {
+	if (status != yajl_gen_status_ok) {
+		PyErr_Format(PyExc_RuntimeError, "YAJL generator error %d", static_cast<int>(status));
+		return false;
+	}
+	return true;
+}
+
+PyObjPtr take_raw_output(JsonSlicer* self) {
+	const unsigned char* buf;
+	size_t len;
+	if (!check_gen_status(yajl_gen_get_buf(self->raw_gen, &buf, &len))) {
+		return {};
+	}
+
+	PyObjPtr output = PyObjPtr::Take(PyBytes_FromStringAndSize(reinterpret_cast<const char*>(buf), len));
+	reset_raw_output(self);
+	return output;
+}
+
+void reset_raw_output(JsonSlicer* self) {
+	yajl_gen_clear(self->raw_gen);
+	yajl_gen_reset(self->raw_gen, nullptr);
+	self->raw_key_pending = false;
+}
+
+PyObjPtr make_string(JsonSlicer* self, const char* data, size_t len) {
+	if (self->intern_values) {
+		return make_map_key(self, data, len);
+	}
+	return self->decoder.decode(data, len);
+}
+
+int select_value(JsonSlicer* self) {
+	if (!self->projection.active()) {
+		return Projection::WHOLE;
+	}
+	if (self->constructing.empty()) {
+		return self->projection.root();
+	}
+
+	Projection::Level& level = self->projection_levels.back();
+	if (level.is_map) {
+		// decided when map key was seen
+		return self->next_field_node;
+	} else {
+		return self->projection.select_index(level.node, level.index++);
+	}
+}
@@ -25,6 +25,29 @@
 
 #include "jsonslicer.hh"
 
+#include <yajl/yajl_gen.h>
+
 bool add_to_parent(JsonSlicer* self, PyObjPtr value);
 
+// decides whether the value which starts is constructed according to
+// fields projection; returns projection node for it, which may be
+// Projection::WHOLE if it's constructed as is, or Projection::SKIP
+int select_value(JsonSlicer* self);
+
+// decoded map key, shared through key cache
+PyObjPtr make_map_key(JsonSlicer* self, const char* data, size_t len);
+
+// decoded string value, shared through key cache if intern_values
+// is enabled
+PyObjPtr make_string(JsonSlicer* self, const char* data, size_t len);
+
+// number from its JSON representation
+PyObjPtr make_number(const char* data, size_t len);
+
+// raw output mode support: generator errors are converted into
+// exceptions, and complete output is taken as bytes
+bool check_gen_status(yajl_gen_status status);
+PyObjPtr take_raw_output(JsonSlicer* self);
+void reset_raw_output(JsonSlicer* self);
+
 #endif
@@ -24,6 +24,10 @@
 
 #include <Python.h>
 
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
 PyObjPtr encode(PyObjPtr obj, PyObjPtr encoding, PyObjPtr errors) {
 	if (encoding && PyUnicode_Check(obj.get())) {
 		return PyObjPtr::Take(
@@ -38,16 +42,117 @@ PyObjPtr encode(PyObjPtr obj, PyObjPtr encoding, PyObjPtr errors) {
 	}
 }
 
-PyObjPtr decode(PyObjPtr obj, PyObjPtr encoding, PyObjPtr errors) {
-	if (encoding && PyBytes_Check(obj.get())) {
-		return PyObjPtr::Take(
-			PyUnicode_FromEncodedObject(
-				obj.get(),
-				PyUnicode_AsUTF8(encoding.get()),
-				PyUnicode_AsUTF8(errors.get())
-			)
-		);
+static bool is_ascii(const char* data, size_t len) {
+	const uint64_t mask = 0x8080808080808080ULL;
+
+	size_t pos = 0;
+	for (; pos + 8 <= len; pos += 8) {
+		uint64_t word;
+		std::memcpy(&word, data + pos, 8);
+		if (word & mask) {
+			return false;
+		}
+	}
+	for (; pos < len; pos++) {
+		if (static_cast<unsigned char>(data[pos]) & 0x80) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool Decoder::open(PyObjPtr encoding, PyObjPtr errors) {
+	if (!encoding) {
+		kind_ = Kind::BYTES;
+		errors_.clear();
+		errors_obj_ = {};
+		codec_decoder_ = {};
+		return true;
+	}
+
+	const char* errors_str = PyUnicode_AsUTF8(errors.get());
+	if (errors_str == nullptr) {
+		return false;
+	}
+
+	// canonical codec name, e.g. "utf-8" for "UTF8"
+	PyObjPtr codecs = PyObjPtr::Take(PyImport_ImportModule("codecs"));
+	if (!codecs) {
+		return false;
+	}
+	PyObjPtr codec_info = PyObjPtr::Take(PyObject_CallMethod(codecs.get(), "lookup", "O", encoding.get()));
+	if (!codec_info) {
+		return false;
+	}
+	PyObjPtr name = PyObjPtr::Take(PyObject_GetAttrString(codec_info.get(), "name"));
+	if (!name) {
+		return false;
+	}
+	const char* name_str = PyUnicode_AsUTF8(name.get());
+	if (name_str == nullptr) {
+		return false;
+	}
+
+	Kind kind;
+	PyObjPtr codec_decoder;
+	if (std::strcmp(name_str, "utf-8") == 0) {
+		kind = Kind::UTF8;
+	} else if (std::strcmp(name_str, "iso8859-1") == 0) {
+		kind = Kind::LATIN1;
 	} else {
-		return obj;
+		kind = Kind::CODEC;
+		codec_decoder = PyObjPtr::Take(PyObject_GetAttrString(codec_info.get(), "decode"));
+		if (!codec_decoder) {
+			return false;
+		}
+	}
+
+	kind_ = kind;
+	errors_ = errors_str;
+	errors_obj_ = errors;
+	codec_decoder_ = codec_decoder;
+
+	return true;
+}
+
+PyObjPtr Decoder::decode(const char* data, size_t len) const {
+	switch (kind_) {
+	case Kind::BYTES:
+		return PyObjPtr::Take(PyBytes_FromStringAndSize(data, len));
+	case Kind::UTF8:
+		if (is_ascii(data, len)) {
+			PyObjPtr str = PyObjPtr::Take(PyUnicode_New(len, 127));
+			if (str) {
+				std::memcpy(PyUnicode_1BYTE_DATA(str.get()), data, len);
+			}
+			return str;
+		}
+		return PyObjPtr::Take(PyUnicode_DecodeUTF8(data, len, errors_.c_str()));
+	case Kind::LATIN1:
+		return PyObjPtr::Take(PyUnicode_DecodeLatin1(data, len, errors_.c_str()));
+	case Kind::CODEC:
+		break;
+	}
+
+	// codec decode function returns (str, consumed) tuple
+	PyObjPtr bytes = PyObjPtr::Take(PyBytes_FromStringAndSize(data, len));
+	if (!bytes) {
+		return {};
 	}
+	PyObjPtr result = PyObjPtr::Take(PyObject_CallFunctionObjArgs(codec_decoder_.get(), bytes.get(), errors_obj_.get(), nullptr));
+	if (!result) {
+		return {};
+	}
+	if (!PyTuple_Check(result.get()) || PyTuple_GET_SIZE(result.get()) != 2 || !PyUnicode_Check(PyTuple_GET_ITEM(result.get(), 0))) {
+		PyErr_SetString(PyExc_TypeError, "Decoder must return a tuple (str, int)");
+		return {};
+	}
+	return PyObjPtr::Borrow(PyTuple_GET_ITEM(result.get(), 0));
+}
+
+void Decoder::swap(Decoder& other) {
+	std::swap(kind_, other.kind_);
+	std::swap(errors_, other.errors_);
+	std::swap(errors_obj_, other.errors_obj_);
+	std::swap(codec_decoder_, other.codec_decoder_);
 }
@@ -25,7 +25,35 @@
 
 #include "pyobjptr.hh"
 
+#include <string>
+
 PyObjPtr encode(PyObjPtr obj, PyObjPtr encoding, PyObjPtr errors);
-PyObjPtr decode(PyObjPtr obj, PyObjPtr encoding, PyObjPtr errors);
+
+// Makes python strings from raw string data. The codec is resolved
+// once, and UTF-8 and Latin-1 are decoded directly from the source
+// buffer, without intermediate bytes object or codec lookup. Without
+// encoding, bytes objects are produced.
+class Decoder {
+private:
+	enum class Kind {
+		BYTES,
+		UTF8,
+		LATIN1,
+		CODEC,
+	};
+
+private:
+	Kind kind_ = Kind::BYTES;
+	std::string errors_;
+	PyObjPtr errors_obj_;
+	PyObjPtr codec_decoder_;
+
+public:
+	bool open(PyObjPtr encoding, PyObjPtr errors);
+
+	PyObjPtr decode(const char* data, size_t len) const;
+
+	void swap(Decoder& other);
+};
 
 #endif
@@ -0,0 +1,444 @@
+/*
+ * Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "filter.hh"
+
+#include "encoding.hh"
+
+#include <Python.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+constexpr size_t Filter::MAX_CONDITIONS;
+
+static int lowest_bit(uint64_t mask) {
+	return __builtin_ctzll(mask);
+}
+
+bool Filter::compile_constant(PyObject* obj, PyObjPtr encoding, PyObjPtr errors, Constant* constant) {
+	if (obj == Py_None) {
+		constant->type = Value::Type::NUL;
+	} else if (PyBool_Check(obj)) {
+		constant->type = Value::Type::BOOLEAN;
+		constant->boolean = obj == Py_True;
+	} else if (PyLong_Check(obj)) {
+		int overflow;
+		long long value = PyLong_AsLongLongAndOverflow(obj, &overflow);
+		if (value == -1 && PyErr_Occurred()) {
+			return false;
+		}
+		if (overflow == 0) {
+			constant->type = Value::Type::INTEGER;
+			constant->integer = value;
+			constant->real = static_cast<double>(value);
+			constant->is_integer = true;
+		} else {
+			constant->type = Value::Type::DOUBLE;
+			constant->real = PyLong_AsDouble(obj);
+			if (constant->real == -1.0 && PyErr_Occurred()) {
+				return false;
+			}
+		}
+	} else if (PyFloat_Check(obj)) {
+		constant->type = Value::Type::DOUBLE;
+		constant->real = PyFloat_AS_DOUBLE(obj);
+	} else if (PyUnicode_Check(obj) || PyBytes_Check(obj)) {
+		PyObjPtr encoded = encode(PyObjPtr::Borrow(obj), encoding, errors);
+		if (!encoded) {
+			return false;
+		}
+		if (!PyBytes_Check(encoded.get())) {
+			PyErr_SetString(PyExc_TypeError, "Cannot encode where value");
+			return false;
+		}
+		constant->type = Value::Type::STRING;
+		constant->string.assign(PyBytes_AS_STRING(encoded.get()), PyBytes_GET_SIZE(encoded.get()));
+	} else {
+		PyErr_Format(PyExc_TypeError, "Unsupported where value type %s", obj->ob_type->tp_name);
+		return false;
+	}
+	return true;
+}
+
+Filter::Value Filter::Value::parse_number(const char* str, size_t len) {
+	std::string number(str, len);
+	if (number.find_first_of(".eE") == std::string::npos) {
+		errno = 0;
+		long long integer = std::strtoll(number.c_str(), nullptr, 10);
+		if (errno == 0) {
+			return make_integer(integer);
+		}
+	}
+	return make_double(std::strtod(number.c_str(), nullptr));
+}
+
+bool Filter::compile_condition(PyObject* item, PyObjPtr encoding, PyObjPtr errors, Condition* condition) {
+	if (!PyTuple_Check(item) || PyTuple_GET_SIZE(item) < 2 || PyTuple_GET_SIZE(item) > 3) {
+		PyErr_SetString(PyExc_TypeError, "where item must be a (path, op, value) or (path, 'exists') tuple");
+		return false;
+	}
+
+	// path; single path element is a shortcut for a path of length 1
+	PyObject* path_arg = PyTuple_GET_ITEM(item, 0);
+	PyObjPtr path;
+	if (path_arg == Py_None || PyUnicode_Check(path_arg) || PyBytes_Check(path_arg) || PyLong_Check(path_arg)) {
+		path = PyObjPtr::Take(PyTuple_Pack(1, path_arg));
+	} else {
+		path = PyObjPtr::Borrow(path_arg);
+	}
+	if (!path) {
+		return false;
+	}
+	if (!condition->path.compile(path.get(), encoding, errors, "where path")) {
+		return false;
+	}
+	if (condition->path.has_any_depth()) {
+		PyErr_SetString(PyExc_ValueError, "Recursive wildcard is not supported in where paths");
+		return false;
+	}
+
+	condition->has_wildcards = false;
+	for (size_t i = 0; i < condition->path.size(); i++) {
+		if (condition->path[i].type == PatternElement::Type::WILDCARD) {
+			condition->has_wildcards = true;
+		}
+	}
+
+	// operator
+	static const struct {
+		const char* name;
+		Op op;
+	} ops[] = {
+		{"==", Op::EQ},
+		{"!=", Op::NE},
+		{"<", Op::LT},
+		{"<=", Op::LE},
+		{">", Op::GT},
+		{">=", Op::GE},
+		{"in", Op::IN},
+		{"exists", Op::EXISTS},
+	};
+
+	PyObject* op_arg = PyTuple_GET_ITEM(item, 1);
+	const char* op_name = PyUnicode_Check(op_arg) ? PyUnicode_AsUTF8(op_arg) : nullptr;
+	if (op_name == nullptr) {
+		if (!PyErr_Occurred()) {
+			PyErr_SetString(PyExc_TypeError, "where operator must be a string");
+		}
+		return false;
+	}
+
+	bool found = false;
+	for (const auto& op: ops) {
+		if (std::strcmp(op.name, op_name) == 0) {
+			condition->op = op.op;
+			found = true;
+			break;
+		}
+	}
+	if (!found) {
+		PyErr_Format(PyExc_ValueError, "Unknown where operator '%s'", op_name);
+		return false;
+	}
+
+	// value(s)
+	if (condition->op == Op::EXISTS) {
+		if (PyTuple_GET_SIZE(item) != 2) {
+			PyErr_SetString(PyExc_TypeError, "'exists' condition takes no value");
+			return false;
+		}
+		return true;
+	}
+
+	if (PyTuple_GET_SIZE(item) != 3) {
+		PyErr_Format(PyExc_TypeError, "'%s' condition requires a value", op_name);
+		return false;
+	}
+
+	PyObject* value_arg = PyTuple_GET_ITEM(item, 2);
+
+	if (condition->op == Op::IN) {
+		PyObjPtr values = PyObjPtr::Take(PySequence_Fast(value_arg, "'in' condition requires iterable value"));
+		if (!values) {
+			return false;
+		}
+		for (Py_ssize_t i = 0; i < PySequence_Fast_GET_SIZE(values.get()); i++) {
+			Constant constant;
+			if (!compile_constant(PySequence_Fast_GET_ITEM(values.get(), i), encoding, errors, &constant)) {
+				return false;
+			}
+			condition->constants.push_back(constant);
+		}
+		return true;
+	}
+
+	Constant constant;
+	if (!compile_constant(value_arg, encoding, errors, &constant)) {
+		return false;
+	}
+
+	if (condition->op != Op::EQ && condition->op != Op::NE && (constant.type == Value::Type::NUL || constant.type == Value::Type::BOOLEAN)) {
+		PyErr_Format(PyExc_TypeError, "'%s' condition requires number or string value", op_name);
+		return false;
+	}
+
+	condition->constants.push_back(constant);
+	return true;
+}
+
+bool Filter::compile(PyObject* where, PyObjPtr encoding, PyObjPtr errors) {
+	std::vector<Condition> conditions;
+
+	if (where != nullptr && where != Py_None) {
+		PyObjPtr items = PyObjPtr::Take(PySequence_Fast(where, "where must be iterable"));
+		if (!items) {
+			return false;
+		}
+
+		if (static_cast<size_t>(PySequence_Fast_GET_SIZE(items.get())) > MAX_CONDITIONS) {
+			PyErr_Format(PyExc_ValueError, "Too many where conditions, at most %zu are supported", MAX_CONDITIONS);
+			return false;
+		}
+
+		for (Py_ssize_t i = 0; i < PySequence_Fast_GET_SIZE(items.get()); i++) {
+			Condition condition;
+			if (!compile_condition(PySequence_Fast_GET_ITEM(items.get(), i), encoding, errors, &condition)) {
+				return false;
+			}
+			conditions.push_back(std::move(condition));
+		}
+	}
+
+	conditions_.swap(conditions);
+	all_ = conditions_.size() == MAX_CONDITIONS ? ~uint64_t(0) : (uint64_t(1) << conditions_.size()) - 1;
+	required_ = all_;
+	captured_.clear();
+	captured_.resize(conditions_.size());
+	satisfied_ = 0;
+	levels_.clear();
+	return true;
+}
+
+// returns sign of value compared to constant
+int Filter::compare(const Constant& constant, const Value& value, bool* comparable) {
+	*comparable = true;
+
+	bool value_is_number = value.type == Value::Type::INTEGER || value.type == Value::Type::DOUBLE;
+	bool constant_is_number = constant.type == Value::Type::INTEGER || constant.type == Value::Type::DOUBLE;
+
+	if (value_is_number && constant_is_number) {
+		if (value.type == Value::Type::INTEGER && constant.is_integer) {
+			return (value.integer > constant.integer) - (value.integer < constant.integer);
+		}
+		double lhs = value.type == Value::Type::INTEGER ? static_cast<double>(value.integer) : value.real;
+		double rhs = constant.real;
+		if (lhs < rhs) {
+			return -1;
+		} else if (lhs > rhs) {
+			return 1;
+		} else if (lhs == rhs) {
+			return 0;
+		}
+		*comparable = false;  // NaN
+		return 0;
+	} else if (value.type != constant.type) {
+		*comparable = false;
+		return 0;
+	}
+
+	switch (value.type) {
+	case Value::Type::NUL:
+		return 0;
+	case Value::Type::BOOLEAN:
+		return value.boolean != constant.boolean;
+	case Value::Type::STRING:
+		{
+			int res = std::memcmp(value.data, constant.string.data(), std::min(value.len, constant.string.size()));
+			if (res == 0) {
+				return (value.len > constant.string.size()) - (value.len < constant.string.size());
+			}
+			return res < 0 ? -1 : 1;
+		}
+	default:
+		*comparable = false;
+		return 0;
+	}
+}
+
+bool Filter::evaluate(const Condition& condition, const Value& value) const {
+	if (condition.op == Op::EXISTS) {
+		return true;
+	}
+	if (value.type == Value::Type::CONTAINER) {
+		return condition.op == Op::NE;
+	}
+
+	bool comparable;
+	if (condition.op == Op::IN) {
+		for (const auto& constant: condition.constants) {
+			if (compare(constant, value, &comparable) == 0 && comparable) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	int res = compare(condition.constants.front(), value, &comparable);
+
+	switch (condition.op) {
+	case Op::EQ: return comparable && res == 0;
+	case Op::NE: return !comparable || res != 0;
+	case Op::LT: return comparable && res < 0;
+	case Op::LE: return comparable && res <= 0;
+	case Op::GT: return comparable && res > 0;
+	case Op::GE: return comparable && res >= 0;
+	default: return false;
+	}
+}
+
+void Filter::start() {
+	satisfied_ = 0;
+	levels_.clear();
+}
+
+uint64_t Filter::enter_value() {
+	if (levels_.empty()) {
+		return all_;
+	}
+
+	Level& top = levels_.back();
+	if (top.is_map) {
+		return top.key_alive;
+	}
+
+	size_t pos = levels_.size() - 1;
+	uint64_t result = 0;
+	for (uint64_t mask = top.alive; mask; mask &= mask - 1) {
+		int i = lowest_bit(mask);
+		if (conditions_[i].path[pos].matches_index(top.index)) {
+			result |= uint64_t(1) << i;
+		}
+	}
+	top.index++;
+	return result;
+}
+
+void Filter::map_key(const char* data, size_t len) {
+	Level& top = levels_.back();
+
+	size_t pos = levels_.size() - 1;
+	uint64_t result = 0;
+	for (uint64_t mask = top.alive; mask; mask &= mask - 1) {
+		int i = lowest_bit(mask);
+		if (conditions_[i].path[pos].matches_key(data, len)) {
+			result |= uint64_t(1) << i;
+		}
+	}
+	top.key_alive = result;
+}
+
+bool Filter::check(uint64_t alive, const Value& value) {
+	size_t depth = levels_.size();
+	for (uint64_t mask = alive; mask; mask &= mask - 1) {
+		int i = lowest_bit(mask);
+		const Condition& condition = conditions_[i];
+		if (condition.path.size() != depth) {
+			continue;
+		}
+		if (condition.op == Op::CAPTURE) {
+			if (!(satisfied_ & (uint64_t(1) << i))) {
+				Captured& captured = captured_[i];
+				captured.value = value;
+				if (value.type == Value::Type::STRING) {
+					captured.string.assign(value.data, value.len);
+					captured.value.data = captured.string.data();
+				}
+				satisfied_ |= uint64_t(1) << i;
+			}
+		} else if (evaluate(condition, value)) {
+			satisfied_ |= uint64_t(1) << i;
+		} else if (!condition.has_wildcards) {
+			// there's no other value this condition may apply to
+			return false;
+		}
+	}
+	return true;
+}
+
+uint64_t Filter::container_mask(uint64_t alive) const {
+	size_t depth = levels_.size();
+	uint64_t result = 0;
+	for (uint64_t mask = alive; mask; mask &= mask - 1) {
+		int i = lowest_bit(mask);
+		if (conditions_[i].path.size() > depth) {
+			result |= uint64_t(1) << i;
+		}
+	}
+	return result;
+}
+
+bool Filter::push(uint64_t alive, bool is_map) {
+	return levels_.push_back(Level{alive, is_map, 0, 0});
+}
+
+void Filter::pop() {
+	levels_.pop_back();
+}
+
+int Filter::add_capture(const Pattern& path) {
+	if (conditions_.size() == MAX_CONDITIONS) {
+		return -1;
+	}
+
+	Condition condition;
+	condition.path = path;
+	condition.has_wildcards = true;  // never rejects anyway
+	condition.op = Op::CAPTURE;
+	conditions_.push_back(std::move(condition));
+	captured_.resize(conditions_.size());
+
+	int index = conditions_.size() - 1;
+	all_ |= uint64_t(1) << index;
+	return index;
+}
+
+const Filter::Value* Filter::captured(int index) const {
+	if (!(satisfied_ & (uint64_t(1) << index))) {
+		return nullptr;
+	}
+	return &captured_[index].value;
+}
+
+void Filter::swap(Filter& other) {
+	conditions_.swap(other.conditions_);
+	std::swap(all_, other.all_);
+	std::swap(required_, other.required_);
+	captured_.swap(other.captured_);
+	satisfied_ = 0;
+	other.satisfied_ = 0;
+	levels_.clear();
+	other.levels_.clear();
+}
@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef JSONSLICER_FILTER_HH
+#define JSONSLICER_FILTER_HH
+
+#include "pattern.hh"
+#include "pyobjptr.hh"
+#include "small_vector.hh"
+
+#include <Python.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Conditions on scalar fields of matched objects, evaluated natively
+// while the object is being parsed. Each condition has a path relative
+// to the matched object, and object passes if all conditions hold.
+//
+// Relative path is tracked as a stack of bitmasks of conditions whose
+// paths may still match, so there's a limit of 64 conditions.
+class Filter {
+public:
+	static constexpr size_t MAX_CONDITIONS = 64;
+
+	// parsed value, as passed by YAJL
+	struct Value {
+		enum class Type {
+			NUL,
+			BOOLEAN,
+			INTEGER,
+			DOUBLE,
+			STRING,
+			CONTAINER,
+		};
+
+		Type type;
+		bool boolean = false;
+		long long integer = 0;
+		double real = 0.0;
+		const char* data = nullptr;
+		size_t len = 0;
+
+		explicit Value(Type t): type(t) {
+		}
+
+		static Value make_boolean(bool val) {
+			Value value(Type::BOOLEAN);
+			value.boolean = val;
+			return value;
+		}
+
+		static Value make_integer(long long val) {
+			Value value(Type::INTEGER);
+			value.integer = val;
+			return value;
+		}
+
+		static Value make_double(double val) {
+			Value value(Type::DOUBLE);
+			value.real = val;
+			return value;
+		}
+
+		static Value make_string(const unsigned char* str, size_t len) {
+			Value value(Type::STRING);
+			value.data = reinterpret_cast<const char*>(str);
+			value.len = len;
+			return value;
+		}
+
+		// number in its JSON representation, as passed by YAJL
+		// when raw numbers are requested
+		static Value parse_number(const char* str, size_t len);
+	};
+
+private:
+	enum class Op {
+		EQ,
+		NE,
+		LT,
+		LE,
+		GT,
+		GE,
+		IN,
+		EXISTS,
+		CAPTURE,  // always holds, records the value
+	};
+
+	struct Constant {
+		Value::Type type;
+		bool boolean = false;
+		long long integer = 0;
+		double real = 0.0;
+		bool is_integer = false;  // for numbers, whether integer member is exact
+		std::string string;
+	};
+
+	struct Condition {
+		Pattern path;
+		bool has_wildcards;
+		Op op;
+		std::vector<Constant> constants;
+	};
+
+	// value recorded by capture condition; string data is copied
+	struct Captured {
+		Value value{Value::Type::NUL};
+		std::string string;
+	};
+
+	struct Level {
+		uint64_t alive;       // conditions which may match inside this container
+		bool is_map;
+		size_t index;         // next array index
+		uint64_t key_alive;   // conditions matching current map key
+	};
+
+private:
+	std::vector<Condition> conditions_;
+	uint64_t all_ = 0;
+	uint64_t required_ = 0;  // all but capture conditions
+	std::vector<Captured> captured_;
+
+	// per matched object state
+	uint64_t satisfied_ = 0;
+	SmallVector<Level, 16> levels_;
+
+private:
+	static int compare(const Constant& constant, const Value& value, bool* comparable);
+	static bool compile_constant(PyObject* obj, PyObjPtr encoding, PyObjPtr errors, Constant* constant);
+	bool compile_condition(PyObject* item, PyObjPtr encoding, PyObjPtr errors, Condition* condition);
+
+	bool evaluate(const Condition& condition, const Value& value) const;
+
+public:
+	// where is an iterable of (path, op, value) or (path, 'exists')
+	// tuples, None means no filtering
+	bool compile(PyObject* where, PyObjPtr encoding, PyObjPtr errors);
+
+	bool active() const {
+		return !conditions_.empty();
+	}
+
+	// matched object starts
+	void start();
+
+	// value starts in current container (or it's the matched value
+	// itself); returns conditions which may apply to it
+	uint64_t enter_value();
+
+	// map key in current container
+	void map_key(const char* data, size_t len);
+
+	// evaluates conditions which end at given value; returns false if
+	// the object cannot pass anymore
+	bool check(uint64_t alive, const Value& value);
+
+	// conditions which may apply inside container with given mask
+	uint64_t container_mask(uint64_t alive) const;
+
+	bool push(uint64_t alive, bool is_map);
+	void pop();
+
+	// whether all conditions were satisfied for the object
+	bool accepted() const {
+		return (satisfied_ & required_) == required_;
+	}
+
+	// adds condition which always holds and records the first value
+	// found at given path; returns its index, or -1 if there are too
+	// many conditions already
+	int add_capture(const Pattern& path);
+
+	// value recorded by capture condition for current object, or
+	// nullptr if there's none
+	const Value* captured(int index) const;
+
+	void swap(Filter& other);
+};
+
+#endif
@@ -23,17 +23,24 @@
 #include "handlers.hh"
 
 #include "output_formatting.hh"
-#include "encoding.hh"
 #include "seek_handlers.hh"
 #include "construct_handlers.hh"
-#include "pymutindex.hh"
 
 #include <Python.h>
 
-template<class T> bool generic_handle_scalar(JsonSlicer* self, T&& make_scalar) {
+template<class T, class U> bool generic_handle_scalar(JsonSlicer* self, const Filter::Value& value, T&& make_scalar, U&& gen_scalar) {
+	if (self->state == JsonSlicer::State::SKIPPING || self->state == JsonSlicer::State::SKIPPING_FIELD) {
+		return true;
+	}
 	if (self->state == JsonSlicer::State::SEEKING) {
-		if (check_pattern(self)) {
+		int match = match_value(self);
+		if (self->matcher.matches(match)) {
+			if (!accept_match(self)) {
+				return reject_object(self, 0);
+			}
 			self->state = JsonSlicer::State::CONSTRUCTING;
+			self->match_state = match;
+			self->filter.start();
 			// falls through to JsonSlicer::State::CONSTRUCTING block below
 		} else {
 			update_path(self);
@@ -41,10 +48,34 @@ template<class T> bool generic_handle_scalar(JsonSlicer* self, T&& make_scalar)
 		}
 	}
 	if (self->state == JsonSlicer::State::CONSTRUCTING) {
-		PyObjPtr scalar = make_scalar();
-		if (scalar) {
-			scalar = decode(scalar, self->output_encoding, self->output_errors);
+		if (self->filter.active() && !self->filter.check(self->filter.enter_value(), value)) {
+			return reject_object(self, self->constructing.size());
+		}
+
+		// scalar is only kept if selected as a whole
+		if (!self->constructing.empty() && select_value(self) != Projection::WHOLE) {
+			self->raw_key_pending = false;
+			return true;
+		}
+
+		if (self->aggregator.active()) {
+			if (self->constructing.empty()) {
+				return finish_complete_object(self, {});
+			}
+			return true;
 		}
+
+		if (self->output_mode == JsonSlicer::OutputMode::RAW) {
+			if (!check_gen_status(gen_scalar(self->raw_gen))) {
+				return false;
+			}
+			if (self->constructing.empty()) {
+				return finish_raw_object(self);
+			}
+			return true;
+		}
+
+		PyObjPtr scalar = make_scalar();
 		if (!scalar) {
 			return false;
 		}
@@ -59,46 +90,156 @@ template<class T> bool generic_handle_scalar(JsonSlicer* self, T&& make_scalar)
 }
 
 template<class T, class U>
-bool generic_start_container(JsonSlicer* self, T&& make_container, U&& make_key) {
+bool generic_start_container(JsonSlicer* self, bool is_map, T&& make_container, U&& push_path) {
+	if (self->state == JsonSlicer::State::SKIPPING || self->state == JsonSlicer::State::SKIPPING_FIELD) {
+		self->skip_depth++;
+		return true;
+	}
 	if (self->state == JsonSlicer::State::SEEKING) {
-	    if (check_pattern(self)) {
+		int match = match_value(self);
+		if (self->matcher.matches(match)) {
+			if (!accept_match(self)) {
+				return reject_object(self, 1);
+			}
 			self->state = JsonSlicer::State::CONSTRUCTING;
+			self->match_state = match;
+			self->filter.start();
 			// falls through to JsonSlicer::State::CONSTRUCTING block below
+		} else if (self->matcher.descends(match)) {
+			if (!push_path() || !self->match_states.push_back(match)) {
+				PyErr_NoMemory();
+				return false;
+			}
+			return true;
 		} else {
-			PyObjPtr key = make_key();
-			if (!key.valid()) {
+			// nothing inside this container may match
+			self->state = JsonSlicer::State::SKIPPING;
+			self->skip_depth = 1;
+			self->stats.skipped_subtrees++;
+			if (self->fast_skip) {
+				// interrupt parser, the rest is handled by skip scanner
+				self->fast_skip_requested = true;
 				return false;
 			}
-			return self->path.push_back(key);
+			return true;
 		}
 	}
 	if (self->state == JsonSlicer::State::CONSTRUCTING) {
-		PyObjPtr container = make_container();
-		if (!container.valid()) {
-			return false;
+		uint64_t filter_mask = 0;
+		if (self->filter.active()) {
+			uint64_t alive = self->filter.enter_value();
+			if (!self->filter.check(alive, Filter::Value(Filter::Value::Type::CONTAINER))) {
+				return reject_object(self, self->constructing.size() + 1);
+			}
+			filter_mask = self->filter.container_mask(alive);
 		}
 
-		if (!self->constructing.empty()) {
-			if (!add_to_parent(self, container)) {
+		// when only counting matched containers, there's no need to
+		// look inside them
+		if (self->aggregator.active() && self->aggregator.count_only() && self->constructing.empty() && filter_mask == 0) {
+			if (self->filter.accepted()) {
+				self->aggregator.add(self->filter);
+			}
+			return reject_object(self, 1);
+		}
+
+		int projection_node = select_value(self);
+		if (projection_node == Projection::SKIP && filter_mask == 0) {
+			self->state = JsonSlicer::State::SKIPPING_FIELD;
+			self->skip_depth = 1;
+			self->stats.skipped_subtrees++;
+			return true;
+		}
+
+		// container which is not constructed, but has to be visited
+		// for the filter, is represented by null placeholder; when
+		// aggregating or in raw output mode, None is used instead of
+		// the container
+		PyObjPtr container;
+		if (projection_node != Projection::SKIP && self->aggregator.active()) {
+			container = PyObjPtr::Borrow(Py_None);
+		} else if (projection_node != Projection::SKIP && self->output_mode == JsonSlicer::OutputMode::RAW) {
+			if (self->raw_key_pending) {
+				self->raw_key_pending = false;
+				if (!check_gen_status(yajl_gen_string(self->raw_gen, reinterpret_cast<const unsigned char*>(self->raw_pending_key.data()), self->raw_pending_key.size()))) {
+					return false;
+				}
+			}
+			if (!check_gen_status(is_map ? yajl_gen_map_open(self->raw_gen) : yajl_gen_array_open(self->raw_gen))) {
+				return false;
+			}
+			container = PyObjPtr::Borrow(Py_None);
+		} else if (projection_node != Projection::SKIP) {
+			container = make_container();
+			if (!container.valid()) {
 				return false;
 			}
+
+			if (!self->constructing.empty()) {
+				if (!add_to_parent(self, container)) {
+					return false;
+				}
+			}
 		}
 
-		return self->constructing.push_back(container);
+		if (!self->constructing.push_back(container)) {
+			PyErr_NoMemory();
+			return false;
+		}
+		self->stats.update_peak_depth(self->constructing.size());
+		if (self->projection.active() && !self->projection_levels.push_back(Projection::Level{projection_node, is_map, 0})) {
+			PyErr_NoMemory();
+			return false;
+		}
+		if (self->filter.active() && !self->filter.push(filter_mask, is_map)) {
+			PyErr_NoMemory();
+			return false;
+		}
+		return true;
 	}
 	return true;
 }
 
-bool generic_end_container(JsonSlicer* self) {
+bool generic_end_container(JsonSlicer* self, bool is_map) {
+	if (self->state == JsonSlicer::State::SKIPPING) {
+		if (--self->skip_depth == 0) {
+			self->state = JsonSlicer::State::SEEKING;
+			update_path(self);
+		}
+		return true;
+	}
+	if (self->state == JsonSlicer::State::SKIPPING_FIELD) {
+		if (--self->skip_depth == 0) {
+			self->state = JsonSlicer::State::CONSTRUCTING;
+		}
+		return true;
+	}
 	if (self->state == JsonSlicer::State::SEEKING) {
-		PyObjPtr container = self->path.pop_back();
-		assert(container);
+		self->path.pop();
+		self->match_states.pop_back();
 		update_path(self);
 	}
 	if (self->state == JsonSlicer::State::CONSTRUCTING) {
 		PyObjPtr container = self->constructing.pop_back();
+		if (self->projection.active()) {
+			self->projection_levels.pop_back();
+		}
+		if (self->filter.active()) {
+			self->filter.pop();
+		}
 
-		if (self->constructing.empty()) {
+		if (self->aggregator.active()) {
+			if (self->constructing.empty()) {
+				return finish_complete_object(self, {});
+			}
+		} else if (self->output_mode == JsonSlicer::OutputMode::RAW) {
+			if (container.valid() && !check_gen_status(is_map ? yajl_gen_map_close(self->raw_gen) : yajl_gen_array_close(self->raw_gen))) {
+				return false;
+			}
+			if (self->constructing.empty()) {
+				return finish_raw_object(self);
+			}
+		} else if (self->constructing.empty()) {
 			return finish_complete_object(self, container);
 		}
 	}
@@ -120,83 +261,327 @@ const yajl_callbacks yajl_handlers = {
 	handle_end_array
 };
 
+// numbers are passed as is in raw output mode
+const yajl_callbacks yajl_raw_handlers = {
+	handle_null,
+	handle_boolean,
+	nullptr,
+	nullptr,
+	handle_number,
+	handle_string,
+	handle_start_map,
+	handle_map_key,
+	handle_end_map,
+	handle_start_array,
+	handle_end_array
+};
+
+// when offsets are needed, end of each parser event is recorded, so
+// the offset preceding any matched value is known
+static int note_event_end(JsonSlicer* self, int result) {
+	self->event_end = self->parse_offset + yajl_get_bytes_consumed(self->yajl);
+	return result;
+}
+
+static int index_null(void* ctx) {
+	return note_event_end((JsonSlicer*)ctx, handle_null(ctx));
+}
+
+static int index_boolean(void* ctx, int val) {
+	return note_event_end((JsonSlicer*)ctx, handle_boolean(ctx, val));
+}
+
+static int index_integer(void* ctx, long long val) {
+	return note_event_end((JsonSlicer*)ctx, handle_integer(ctx, val));
+}
+
+static int index_double(void* ctx, double val) {
+	return note_event_end((JsonSlicer*)ctx, handle_double(ctx, val));
+}
+
+static int index_number(void* ctx, const char* str, size_t len) {
+	return note_event_end((JsonSlicer*)ctx, handle_number(ctx, str, len));
+}
+
+static int index_string(void* ctx, const unsigned char* str, size_t len) {
+	return note_event_end((JsonSlicer*)ctx, handle_string(ctx, str, len));
+}
+
+static int index_start_map(void* ctx) {
+	return note_event_end((JsonSlicer*)ctx, handle_start_map(ctx));
+}
+
+static int index_map_key(void* ctx, const unsigned char* str, size_t len) {
+	return note_event_end((JsonSlicer*)ctx, handle_map_key(ctx, str, len));
+}
+
+static int index_end_map(void* ctx) {
+	return note_event_end((JsonSlicer*)ctx, handle_end_map(ctx));
+}
+
+static int index_start_array(void* ctx) {
+	return note_event_end((JsonSlicer*)ctx, handle_start_array(ctx));
+}
+
+static int index_end_array(void* ctx) {
+	return note_event_end((JsonSlicer*)ctx, handle_end_array(ctx));
+}
+
+const yajl_callbacks yajl_index_handlers = {
+	index_null,
+	index_boolean,
+	index_integer,
+	index_double,
+	nullptr,
+	index_string,
+	index_start_map,
+	index_map_key,
+	index_end_map,
+	index_start_array,
+	index_end_array
+};
+
+const yajl_callbacks yajl_raw_index_handlers = {
+	index_null,
+	index_boolean,
+	nullptr,
+	nullptr,
+	index_number,
+	index_string,
+	index_start_map,
+	index_map_key,
+	index_end_map,
+	index_start_array,
+	index_end_array
+};
+
+const yajl_callbacks* select_handlers(bool raw_output, bool tracking_offsets) {
+	if (tracking_offsets) {
+		return raw_output ? &yajl_raw_index_handlers : &yajl_index_handlers;
+	}
+	return raw_output ? &yajl_raw_handlers : &yajl_handlers;
+}
+
+// with timing argument, time spent in handlers is measured around
+// the handlers selected above
+static int note_handler_time(JsonSlicer* self, uint64_t start, int result) {
+	self->stats.handlers_ns += Stats::now() - start;
+	return result;
+}
+
+static int timed_null(void* ctx) {
+	uint64_t start = Stats::now();
+	return note_handler_time((JsonSlicer*)ctx, start, ((JsonSlicer*)ctx)->timed_handlers->yajl_null(ctx));
+}
+
+static int timed_boolean(void* ctx, int val) {
+	uint64_t start = Stats::now();
+	return note_handler_time((JsonSlicer*)ctx, start, ((JsonSlicer*)ctx)->timed_handlers->yajl_boolean(ctx, val));
+}
+
+static int timed_integer(void* ctx, long long val) {
+	uint64_t start = Stats::now();
+	return note_handler_time((JsonSlicer*)ctx, start, ((JsonSlicer*)ctx)->timed_handlers->yajl_integer(ctx, val));
+}
+
+static int timed_double(void* ctx, double val) {
+	uint64_t start = Stats::now();
+	return note_handler_time((JsonSlicer*)ctx, start, ((JsonSlicer*)ctx)->timed_handlers->yajl_double(ctx, val));
+}
+
+static int timed_number(void* ctx, const char* str, size_t len) {
+	uint64_t start = Stats::now();
+	return note_handler_time((JsonSlicer*)ctx, start, ((JsonSlicer*)ctx)->timed_handlers->yajl_number(ctx, str, len));
+}
+
+static int timed_string(void* ctx, const unsigned char* str, size_t len) {
+	uint64_t start = Stats::now();
+	return note_handler_time((JsonSlicer*)ctx, start, ((JsonSlicer*)ctx)->timed_handlers->yajl_string(ctx, str, len));
+}
+
+static int timed_start_map(void* ctx) {
+	uint64_t start = Stats::now();
+	return note_handler_time((JsonSlicer*)ctx, start, ((JsonSlicer*)ctx)->timed_handlers->yajl_start_map(ctx));
+}
+
+static int timed_map_key(void* ctx, const unsigned char* str, size_t len) {
+	uint64_t start = Stats::now();
+	return note_handler_time((JsonSlicer*)ctx, start, ((JsonSlicer*)ctx)->timed_handlers->yajl_map_key(ctx, str, len));
+}
+
+static int timed_end_map(void* ctx) {
+	uint64_t start = Stats::now();
+	return note_handler_time((JsonSlicer*)ctx, start, ((JsonSlicer*)ctx)->timed_handlers->yajl_end_map(ctx));
+}
+
+static int timed_start_array(void* ctx) {
+	uint64_t start = Stats::now();
+	return note_handler_time((JsonSlicer*)ctx, start, ((JsonSlicer*)ctx)->timed_handlers->yajl_start_array(ctx));
+}
+
+static int timed_end_array(void* ctx) {
+	uint64_t start = Stats::now();
+	return note_handler_time((JsonSlicer*)ctx, start, ((JsonSlicer*)ctx)->timed_handlers->yajl_end_array(ctx));
+}
+
+const yajl_callbacks yajl_timed_handlers = {
+	timed_null,
+	timed_boolean,
+	timed_integer,
+	timed_double,
+	nullptr,
+	timed_string,
+	timed_start_map,
+	timed_map_key,
+	timed_end_map,
+	timed_start_array,
+	timed_end_array
+};
+
+const yajl_callbacks yajl_raw_timed_handlers = {
+	timed_null,
+	timed_boolean,
+	nullptr,
+	nullptr,
+	timed_number,
+	timed_string,
+	timed_start_map,
+	timed_map_key,
+	timed_end_map,
+	timed_start_array,
+	timed_end_array
+};
+
+const yajl_callbacks* select_timed_handlers(bool raw_output) {
+	return raw_output ? &yajl_raw_timed_handlers : &yajl_timed_handlers;
+}
+
 int handle_null(void* ctx) {
-	return generic_handle_scalar((JsonSlicer*)ctx, [](){
+	((JsonSlicer*)ctx)->stats.tokens[Stats::NUL]++;
+	return generic_handle_scalar((JsonSlicer*)ctx, Filter::Value(Filter::Value::Type::NUL), [](){
 		return PyObjPtr::Borrow(Py_None);
+	}, [](yajl_gen gen){
+		return yajl_gen_null(gen);
 	});
 }
 
 int handle_boolean(void* ctx, int val) {
-	return generic_handle_scalar((JsonSlicer*)ctx, [val](){
+	((JsonSlicer*)ctx)->stats.tokens[Stats::BOOLEAN]++;
+	return generic_handle_scalar((JsonSlicer*)ctx, Filter::Value::make_boolean(val), [val](){
 		return PyObjPtr::Borrow(val ? Py_True : Py_False);
+	}, [val](yajl_gen gen){
+		return yajl_gen_bool(gen, val);
 	});
 }
 
 int handle_integer(void* ctx, long long val) {
-	return generic_handle_scalar((JsonSlicer*)ctx, [val](){
+	((JsonSlicer*)ctx)->stats.tokens[Stats::NUMBER]++;
+	return generic_handle_scalar((JsonSlicer*)ctx, Filter::Value::make_integer(val), [val](){
 		return PyObjPtr::Take(PyLong_FromLongLong(val));
+	}, [val](yajl_gen gen){
+		return yajl_gen_integer(gen, val);
 	});
 }
 
 int handle_double(void* ctx, double val) {
-	return generic_handle_scalar((JsonSlicer*)ctx, [val](){
+	((JsonSlicer*)ctx)->stats.tokens[Stats::NUMBER]++;
+	return generic_handle_scalar((JsonSlicer*)ctx, Filter::Value::make_double(val), [val](){
 		return PyObjPtr::Take(PyFloat_FromDouble(val));
+	}, [val](yajl_gen gen){
+		return yajl_gen_double(gen, val);
+	});
+}
+
+int handle_number(void* ctx, const char* str, size_t len) {
+	JsonSlicer* self = (JsonSlicer*)ctx;
+	self->stats.tokens[Stats::NUMBER]++;
+	Filter::Value value = self->filter.active() ? Filter::Value::parse_number(str, len) : Filter::Value(Filter::Value::Type::NUL);
+	return generic_handle_scalar(self, value, [str, len](){
+		return make_number(str, len);
+	}, [str, len](yajl_gen gen){
+		return yajl_gen_number(gen, str, len);
 	});
 }
 
 int handle_string(void* ctx, const unsigned char* str, size_t len) {
-	return generic_handle_scalar((JsonSlicer*)ctx, [str, len](){
-		return PyObjPtr::Take(PyBytes_FromStringAndSize(reinterpret_cast<const char*>(str), len));
+	JsonSlicer* self = (JsonSlicer*)ctx;
+	self->stats.tokens[Stats::STRING]++;
+	return generic_handle_scalar(self, Filter::Value::make_string(str, len), [self, str, len](){
+		return make_string(self, reinterpret_cast<const char*>(str), len);
+	}, [str, len](yajl_gen gen){
+		return yajl_gen_string(gen, str, len);
 	});
 }
 
 // map key
 int handle_map_key(void* ctx, const unsigned char* str, size_t len) {
 	JsonSlicer* self = (JsonSlicer*)ctx;
+	self->stats.tokens[Stats::MAP_KEY]++;
 
-	PyObjPtr key = PyObjPtr::Take(PyBytes_FromStringAndSize(reinterpret_cast<const char*>(str), len));
-#ifdef USE_BYTES_INTERNALLY
-	if (key && self->state == JsonSlicer::State::CONSTRUCTING) {
-		key = decode(key, self->output_encoding, self->output_errors);
-	}
-#else // use output encoding internally
-	if (key) {
-		key = decode(key, self->output_encoding, self->output_errors);
-	}
-#endif
-	if (!key.valid()) {
-		return false;
-	}
+	if (self->state == JsonSlicer::State::SKIPPING || self->state == JsonSlicer::State::SKIPPING_FIELD) {
+		return true;
+	} else if (self->state == JsonSlicer::State::CONSTRUCTING) {
+		if (self->filter.active()) {
+			self->filter.map_key(reinterpret_cast<const char*>(str), len);
+		}
+		if (self->projection.active()) {
+			const Projection::Level& level = self->projection_levels.back();
+			self->next_field_node = self->projection.select_key(level.node, reinterpret_cast<const char*>(str), len);
+			if (self->next_field_node == Projection::SKIP) {
+				// value will be skipped, so key is not needed
+				return true;
+			}
+		}
+
+		if (self->output_mode == JsonSlicer::OutputMode::RAW) {
+			if (self->projection.active() && self->next_field_node != Projection::WHOLE) {
+				// value may yet be dropped, see generic_handle_scalar()
+				self->raw_pending_key.assign(reinterpret_cast<const char*>(str), len);
+				self->raw_key_pending = true;
+				return true;
+			}
+			return check_gen_status(yajl_gen_string(self->raw_gen, str, len));
+		}
+
+		PyObjPtr key = make_map_key(self, reinterpret_cast<const char*>(str), len);
+		if (!key.valid()) {
+			return false;
+		}
 
-	if (self->state == JsonSlicer::State::CONSTRUCTING) {
 		self->last_map_key = key;
 	} else {
-		self->path.back() = key;
+		self->path.set_key(reinterpret_cast<const char*>(str), len);
 	}
 	return true;
 }
 
 // containers
 int handle_start_map(void* ctx) {
+	((JsonSlicer*)ctx)->stats.tokens[Stats::START_MAP]++;
 	return generic_start_container(
 		(JsonSlicer*)ctx,
+		true,
 		[]{ return PyObjPtr::Take(PyDict_New()); },
-		[]{ return PyObjPtr::Borrow(Py_None); }
+		[ctx]{ return ((JsonSlicer*)ctx)->path.push_map(); }
 	);
 }
 
 int handle_end_map(void* ctx) {
-	return generic_end_container((JsonSlicer*)ctx);
+	((JsonSlicer*)ctx)->stats.tokens[Stats::END_MAP]++;
+	return generic_end_container((JsonSlicer*)ctx, true);
 }
 
 int handle_start_array(void* ctx) {
+	((JsonSlicer*)ctx)->stats.tokens[Stats::START_ARRAY]++;
 	return generic_start_container(
 		(JsonSlicer*)ctx,
+		false,
 		[]{ return PyObjPtr::Take(PyList_New(0)); },
-		[]{ return PyObjPtr::Take(PyMutIndex_New()); }
+		[ctx]{ return ((JsonSlicer*)ctx)->path.push_array(); }
 	);
 }
 
 int handle_end_array(void* ctx) {
-	return generic_end_container((JsonSlicer*)ctx);
+	((JsonSlicer*)ctx)->stats.tokens[Stats::END_ARRAY]++;
+	return generic_end_container((JsonSlicer*)ctx, false);
 }
@@ -26,11 +26,25 @@
 #include <yajl/yajl_parse.h>
 
 extern const yajl_callbacks yajl_handlers;
+extern const yajl_callbacks yajl_raw_handlers;
+extern const yajl_callbacks yajl_index_handlers;
+extern const yajl_callbacks yajl_raw_index_handlers;
+extern const yajl_callbacks yajl_timed_handlers;
+extern const yajl_callbacks yajl_raw_timed_handlers;
+
+// handlers for output mode, raw output needs numbers as is; indexing
+// handlers additionally track offsets of parser events
+const yajl_callbacks* select_handlers(bool raw_output, bool tracking_offsets = false);
+
+// handlers which measure time spent in JsonSlicer::timed_handlers
+const yajl_callbacks* select_timed_handlers(bool raw_output);
+
 
 int handle_null(void* ctx);
 int handle_boolean(void* ctx, int val);
 int handle_integer(void* ctx, long long val);
 int handle_double(void* ctx, double val);
+int handle_number(void* ctx, const char* str, size_t len);
 int handle_string(void* ctx, const unsigned char* str, size_t len);
 int handle_start_map(void* ctx);
 int handle_map_key(void* ctx, const unsigned char* str, size_t len);
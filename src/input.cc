@@ -0,0 +1,416 @@
+/*
+ * Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "input.hh"
+
+#include "encoding.hh"
+
+#include <Python.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <algorithm>
+#include <utility>
+
+#ifndef O_CLOEXEC
+# define O_CLOEXEC 0
+#endif
+
+Input::~Input() {
+	close();
+}
+
+void Input::close() {
+	if (mapping_ != nullptr) {
+		munmap(mapping_, mapping_size_);
+		mapping_ = nullptr;
+	}
+	if (owns_fd_ && fd_ != -1) {
+		::close(fd_);
+	}
+	fd_ = -1;
+	owns_fd_ = false;
+}
+
+bool Input::open(PyObject* io, Py_ssize_t read_size, PyObjPtr encoding, PyObjPtr errors) {
+	if (PyLong_Check(io)) {
+		int fd = PyObject_AsFileDescriptor(io);
+		if (fd == -1) {
+			return false;
+		}
+		return open_descriptor(io, fd, false, read_size);
+	} else if (PyUnicode_Check(io) || PyBytes_Check(io) || PyObject_HasAttrString(io, "__fspath__")) {
+		PyObject* path_raw = nullptr;
+		if (!PyUnicode_FSConverter(io, &path_raw)) {
+			return false;
+		}
+		PyObjPtr path = PyObjPtr::Take(path_raw);
+
+		const char* path_str = PyBytes_AS_STRING(path.get());
+		int fd;
+		do {
+			Py_BEGIN_ALLOW_THREADS
+			fd = ::open(path_str, O_RDONLY | O_CLOEXEC);
+			Py_END_ALLOW_THREADS
+		} while (fd == -1 && errno == EINTR && PyErr_CheckSignals() == 0);
+
+		if (fd == -1) {
+			if (!PyErr_Occurred()) {
+				PyErr_SetFromErrnoWithFilenameObject(PyExc_OSError, io);
+			}
+			return false;
+		}
+		return open_descriptor(io, fd, true, read_size);
+	} else {
+		return open_python(io, read_size, encoding, errors);
+	}
+}
+
+bool Input::open_python(PyObject* io, Py_ssize_t read_size, PyObjPtr encoding, PyObjPtr errors) {
+	// text streams do not have readinto(), so for them read() result
+	// is always str which is encoded back into bytes
+	bool readinto = read_size > 0 && PyObject_HasAttrString(io, "readinto");
+
+	PyObjPtr read_method = PyObjPtr::Take(PyObject_GetAttrString(io, readinto ? "readinto" : "read"));
+	if (!read_method) {
+		return false;
+	}
+
+	PyObjPtr read_size_obj;
+	PyObjPtr buffer;
+	if (readinto) {
+		buffer = PyObjPtr::Take(PyByteArray_FromStringAndSize(nullptr, read_size));
+		if (!buffer) {
+			return false;
+		}
+	} else {
+		read_size_obj = PyObjPtr::Take(PyLong_FromSsize_t(read_size));
+		if (!read_size_obj) {
+			return false;
+		}
+	}
+
+	close();
+
+	type_ = Type::PYTHON;
+	read_size_ = read_size > 0 ? read_size : 0;
+	position_ = 0;
+	io_ = PyObjPtr::Borrow(io);
+	encoding_ = encoding;
+	errors_ = errors;
+	read_method_ = read_method;
+	read_size_obj_ = read_size_obj;
+	buffer_ = buffer;
+	readinto_ = readinto;
+
+	return true;
+}
+
+bool Input::open_descriptor(PyObject* io, int fd, bool owned, Py_ssize_t read_size) {
+	// make sure fd we've opened is closed on all error paths
+	Input guard;
+	guard.fd_ = fd;
+	guard.owns_fd_ = owned;
+
+	if (read_size <= 0) {
+		PyErr_SetString(PyExc_ValueError, "read_size must be positive for file path or descriptor input");
+		return false;
+	}
+
+	struct stat st;
+	int res;
+	Py_BEGIN_ALLOW_THREADS
+	res = fstat(fd, &st);
+	Py_END_ALLOW_THREADS
+	if (res == -1) {
+		PyErr_SetFromErrnoWithFilenameObject(PyExc_OSError, io);
+		return false;
+	}
+
+	// regular files are mapped whole, and parsing starts from the
+	// current descriptor offset; if anything fails, just fall back
+	// to read(2)
+	if (S_ISREG(st.st_mode)) {
+		off_t offset = lseek(fd, 0, SEEK_CUR);
+		if (offset >= 0 && st.st_size > offset) {
+			void* mapping;
+			Py_BEGIN_ALLOW_THREADS
+			mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (mapping != MAP_FAILED) {
+				madvise(mapping, st.st_size, MADV_SEQUENTIAL);
+			}
+			Py_END_ALLOW_THREADS
+
+			if (mapping != MAP_FAILED) {
+				guard.mapping_ = static_cast<unsigned char*>(mapping);
+				guard.mapping_size_ = st.st_size;
+				guard.mapping_pos_ = offset;
+				guard.type_ = Type::MAPPING;
+			}
+		}
+	}
+
+	if (guard.type_ != Type::MAPPING) {
+		guard.type_ = Type::DESCRIPTOR;
+		guard.native_buffer_.resize(read_size);
+	} else if (guard.owns_fd_) {
+		// mapping stays valid after descriptor is closed
+		::close(guard.fd_);
+		guard.fd_ = -1;
+		guard.owns_fd_ = false;
+	}
+
+	guard.read_size_ = read_size;
+	guard.io_ = PyObjPtr::Borrow(io);
+
+	swap(guard);
+	return true;
+}
+
+bool Input::read(const unsigned char** data, size_t* len) {
+	bool success = false;
+	switch (type_) {
+	case Type::PYTHON:
+		success = read_python(data, len);
+		break;
+	case Type::DESCRIPTOR:
+		success = read_descriptor(data, len);
+		break;
+	case Type::MAPPING:
+		success = read_native(data, len);
+		break;
+	case Type::NONE:
+		PyErr_SetString(PyExc_RuntimeError, "Input is not open");
+		break;
+	}
+
+	if (success) {
+		position_ += *len;
+	}
+	return success;
+}
+
+// text stream positions are characters or opaque cookies rather than
+// offsets in encoded input, and they only allow relative seek by zero
+static bool check_binary_stream(PyObject* io) {
+	PyObjPtr io_module = PyObjPtr::Take(PyImport_ImportModule("io"));
+	if (!io_module) {
+		return false;
+	}
+	PyObjPtr text_io_base = PyObjPtr::Take(PyObject_GetAttrString(io_module.get(), "TextIOBase"));
+	if (!text_io_base) {
+		return false;
+	}
+
+	int is_text = PyObject_IsInstance(io, text_io_base.get());
+	if (is_text == -1) {
+		return false;
+	}
+	if (is_text) {
+		PyErr_SetString(PyExc_ValueError, "Seeking is not supported for text input, open it in binary mode");
+		return false;
+	}
+	return true;
+}
+
+bool Input::seek(uint64_t offset) {
+	// python object and descriptor positions are exactly at the end
+	// of the last chunk, so they are moved relatively
+	int64_t delta = static_cast<int64_t>(offset - position_);
+
+	if (type_ == Type::MAPPING) {
+		if (delta < -static_cast<int64_t>(mapping_pos_) || delta > static_cast<int64_t>(mapping_size_ - mapping_pos_)) {
+			PyErr_SetString(PyExc_ValueError, "Seek offset is out of input bounds");
+			return false;
+		}
+		mapping_pos_ += delta;
+	} else if (type_ == Type::DESCRIPTOR) {
+		off_t res;
+		Py_BEGIN_ALLOW_THREADS
+		res = lseek(fd_, delta, SEEK_CUR);
+		Py_END_ALLOW_THREADS
+		if (res == -1) {
+			PyErr_SetFromErrno(PyExc_OSError);
+			return false;
+		}
+	} else if (type_ == Type::PYTHON) {
+		if (!check_binary_stream(io_.get())) {
+			return false;
+		}
+		PyObjPtr result = PyObjPtr::Take(PyObject_CallMethod(io_.get(), "seek", "Li", static_cast<long long>(delta), SEEK_CUR));
+		if (!result) {
+			return false;
+		}
+	} else {
+		PyErr_SetString(PyExc_RuntimeError, "Input is not open");
+		return false;
+	}
+
+	position_ = offset;
+	return true;
+}
+
+bool Input::set_read_size(size_t read_size) {
+	if (type_ == Type::PYTHON) {
+		if (readinto_) {
+			if (PyByteArray_Resize(buffer_.get(), read_size) == -1) {
+				return false;
+			}
+		} else {
+			PyObjPtr read_size_obj = PyObjPtr::Take(PyLong_FromSize_t(read_size));
+			if (!read_size_obj) {
+				return false;
+			}
+			read_size_obj_ = read_size_obj;
+		}
+	} else if (type_ == Type::DESCRIPTOR) {
+		native_buffer_.resize(read_size);
+	}
+
+	read_size_ = read_size;
+	return true;
+}
+
+bool Input::read_python(const unsigned char** data, size_t* len) {
+	if (readinto_) {
+		PyObjPtr result = PyObjPtr::Take(PyObject_CallFunctionObjArgs(read_method_.get(), buffer_.get(), nullptr));
+		if (!result) {
+			return false;
+		}
+		if (!PyLong_Check(result.get())) {
+			PyErr_Format(PyExc_RuntimeError, "Unexpected readinto result type %s, expected int", result.get()->ob_type->tp_name);
+			return false;
+		}
+
+		Py_ssize_t size = PyLong_AsSsize_t(result.get());
+		if (size == -1 && PyErr_Occurred()) {
+			return false;
+		}
+		if (size < 0 || size > PyByteArray_GET_SIZE(buffer_.get())) {
+			PyErr_Format(PyExc_RuntimeError, "Unexpected readinto result %zd", size);
+			return false;
+		}
+
+		*data = reinterpret_cast<const unsigned char*>(PyByteArray_AS_STRING(buffer_.get()));
+		*len = size;
+		return true;
+	}
+
+	PyObjPtr buffer = PyObjPtr::Take(PyObject_CallFunctionObjArgs(read_method_.get(), read_size_obj_.get(), nullptr));
+
+	// handle i/o errors
+	if (!buffer) {
+		return false;
+	}
+	if (PyUnicode_Check(buffer.get())) {
+		buffer = encode(buffer, encoding_, errors_);
+		if (!buffer) {
+			return false;
+		}
+	}
+	if (!PyBytes_Check(buffer.get())) {
+		PyErr_Format(PyExc_RuntimeError, "Unexpected read result type %s, expected bytes", buffer.get()->ob_type->tp_name);
+		return false;
+	}
+
+	buffer_ = buffer;
+	*data = reinterpret_cast<const unsigned char*>(PyBytes_AS_STRING(buffer_.get()));
+	*len = PyBytes_GET_SIZE(buffer_.get());
+	return true;
+}
+
+bool Input::read_descriptor(const unsigned char** data, size_t* len) {
+	bool success;
+	do {
+		Py_BEGIN_ALLOW_THREADS
+		success = read_native(data, len);
+		Py_END_ALLOW_THREADS
+	} while (!success && errno == EINTR && PyErr_CheckSignals() == 0);
+
+	if (!success) {
+		if (!PyErr_Occurred()) {
+			PyErr_SetFromErrno(PyExc_OSError);
+		}
+		return false;
+	}
+
+	return true;
+}
+
+bool Input::is_native() const {
+	return type_ == Type::DESCRIPTOR || type_ == Type::MAPPING;
+}
+
+bool Input::read_native(const unsigned char** data, size_t* len) {
+	if (type_ == Type::MAPPING) {
+		size_t size = std::min(read_size_, mapping_size_ - mapping_pos_);
+
+		*data = mapping_ + mapping_pos_;
+		*len = size;
+		mapping_pos_ += size;
+		return true;
+	}
+
+	ssize_t size = ::read(fd_, native_buffer_.data(), native_buffer_.size());
+	if (size == -1) {
+		return false;
+	}
+
+	*data = native_buffer_.data();
+	*len = size;
+	return true;
+}
+
+bool Input::is_mapped() const {
+	return type_ == Type::MAPPING;
+}
+
+const unsigned char* Input::mapped_data() const {
+	return mapping_ + mapping_pos_;
+}
+
+size_t Input::mapped_size() const {
+	return mapping_size_ - mapping_pos_;
+}
+
+void Input::swap(Input& other) {
+	std::swap(type_, other.type_);
+	std::swap(read_size_, other.read_size_);
+	std::swap(position_, other.position_);
+	std::swap(io_, other.io_);
+	std::swap(encoding_, other.encoding_);
+	std::swap(errors_, other.errors_);
+	std::swap(read_method_, other.read_method_);
+	std::swap(read_size_obj_, other.read_size_obj_);
+	std::swap(buffer_, other.buffer_);
+	std::swap(readinto_, other.readinto_);
+	std::swap(fd_, other.fd_);
+	std::swap(owns_fd_, other.owns_fd_);
+	std::swap(native_buffer_, other.native_buffer_);
+	std::swap(mapping_, other.mapping_);
+	std::swap(mapping_size_, other.mapping_size_);
+	std::swap(mapping_pos_, other.mapping_pos_);
+}
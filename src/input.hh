@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef JSONSLICER_INPUT_HH
+#define JSONSLICER_INPUT_HH
+
+#include "pyobjptr.hh"
+
+#include <Python.h>
+
+#include <cstdint>
+#include <vector>
+
+// Reads input data in chunks. Input may be:
+// - python file-like object. If it supports readinto(), data is read
+//   into a preallocated buffer reused for all reads, otherwise read()
+//   is used
+// - file path or file descriptor. Regular files are memory mapped,
+//   and chunks are just pointers into the mapping, otherwise data is
+//   read with read(2) without holding the GIL
+class Input {
+private:
+	enum class Type {
+		NONE,
+		PYTHON,
+		DESCRIPTOR,
+		MAPPING,
+	};
+
+private:
+	Type type_ = Type::NONE;
+	size_t read_size_ = 0;
+	uint64_t position_ = 0;  // bytes returned by read() since open
+
+	// python file-like object
+	PyObjPtr io_;
+	PyObjPtr encoding_;
+	PyObjPtr errors_;
+
+	PyObjPtr read_method_;   // bound readinto() or read()
+	PyObjPtr read_size_obj_; // read() argument
+	PyObjPtr buffer_;        // readinto() target, or last read() result
+	bool readinto_ = false;
+
+	// file descriptor
+	int fd_ = -1;
+	bool owns_fd_ = false;
+	std::vector<unsigned char> native_buffer_;
+
+	// memory mapping
+	unsigned char* mapping_ = nullptr;
+	size_t mapping_size_ = 0;
+	size_t mapping_pos_ = 0;
+
+private:
+	bool open_python(PyObject* io, Py_ssize_t read_size, PyObjPtr encoding, PyObjPtr errors);
+	bool open_descriptor(PyObject* io, int fd, bool owned, Py_ssize_t read_size);
+
+	bool read_python(const unsigned char** data, size_t* len);
+	bool read_descriptor(const unsigned char** data, size_t* len);
+
+	void close();
+
+public:
+	Input() = default;
+	~Input();
+
+	Input(const Input&) = delete;
+	Input& operator=(const Input&) = delete;
+
+	bool open(PyObject* io, Py_ssize_t read_size, PyObjPtr encoding, PyObjPtr errors);
+
+	// reads next chunk of data, which stays valid until next call;
+	// empty chunk means EOF
+	bool read(const unsigned char** data, size_t* len);
+
+	// changes size of chunks returned by subsequent reads; invalidates
+	// the last chunk
+	bool set_read_size(size_t read_size);
+
+	// offset of the next chunk, relative to the position where input
+	// was opened
+	uint64_t position() const {
+		return position_;
+	}
+
+	// makes next read start at the given offset, relative to the
+	// position where input was opened; input must be seekable, and
+	// not a text stream
+	bool seek(uint64_t offset);
+
+	// whether input is a file path or descriptor, which may be read
+	// with read_native()
+	bool is_native() const;
+
+	// same as read(), but for native input only; does not touch
+	// python state, so may be called without GIL or from another
+	// thread; sets errno on failure
+	bool read_native(const unsigned char** data, size_t* len);
+
+	// whether input is a memory mapped file; its unread part is then
+	// available as a whole via mapped_data() and mapped_size()
+	bool is_mapped() const;
+	const unsigned char* mapped_data() const;
+	size_t mapped_size() const;
+
+	void swap(Input& other);
+};
+
+#endif
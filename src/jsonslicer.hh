@@ -23,16 +23,37 @@
 #ifndef JSONSLICER_JSONSLICER_HH
 #define JSONSLICER_JSONSLICER_HH
 
-#include "pyobjlist.hh"
+#include "aggregator.hh"
+#include "encoding.hh"
+#include "filter.hh"
+#include "input.hh"
+#include "key_cache.hh"
+#include "matcher.hh"
+#include "offset_index.hh"
+#include "parallel_parser.hh"
+#include "output_sink.hh"
+#include "path.hh"
+#include "pipeline.hh"
+#include "projection.hh"
 #include "pyobjptr.hh"
+#include "read_size_tuner.hh"
+#include "ring_buffer.hh"
+#include "skip_scanner.hh"
+#include "small_vector.hh"
+#include "stats.hh"
 
 #include <Python.h>
+#include <yajl/yajl_gen.h>
 #include <yajl/yajl_parse.h>
 
+#include <string>
+
 struct JsonSlicer {
 	enum class State {
 		SEEKING,
-		CONSTRUCTING
+		SKIPPING,  // inside subtree which cannot match, only depth is tracked
+		CONSTRUCTING,
+		SKIPPING_FIELD,  // inside unselected field of constructed object, only depth is tracked
 	};
 
 	enum class PathMode {
@@ -41,44 +62,158 @@ struct JsonSlicer {
 		FULL,
 	};
 
+	enum class OutputMode {
+		OBJECTS,
+		RAW,  // matched values are serialized back into JSON bytes
+	};
+
 	PyObject_HEAD
 
 	// arguments
-	PyObjPtr io;
 	Py_ssize_t read_size;
+	bool read_size_auto;
 	PathMode path_mode;
-	PyObjPtr input_encoding;
-	PyObjPtr input_errors;
+	OutputMode output_mode;
 	PyObjPtr output_encoding;
 	PyObjPtr output_errors;
 	int yajl_verbose_errors;
+	int yajl_flags;
+	int fast_skip;
+	int pipelined;
+	Py_ssize_t threads;
+	int intern_values;
+	int checkpoints;
+	int timing;
+
+	// whether parser reports numbers as is; set in raw output mode,
+	// and by dump_ndjson(), which replaces the parser for it
+	bool raw_numbers;
+
+	// input reader
+	Input input;
+	ReadSizeTuner read_size_tuner;
 
 	// YAJL handle
 	yajl_handle yajl;
 
+	// handlers wrapped by timing ones, with timing argument
+	const yajl_callbacks* timed_handlers;
+
+	// runtime counters
+	Stats stats;
+
+	// whether any input was read, and offset of data which is being
+	// fed to the parser
+	bool started;
+	uint64_t parse_offset;
+
+	// offset of the end of the last parser event, only tracked while
+	// building offset index or with checkpoints
+	uint64_t event_end;
+
+	// background reader and tokenizer, replaces input and YAJL
+	// handle above in pipelined mode
+	Pipeline pipeline;
+
+	// worker pool which parses parts of input concurrently, replaces
+	// input and YAJL handle when threads argument is given
+	ParallelParser parallel;
+
 	// parser state
 	PyObjPtr last_map_key;
 	State state;
+	size_t skip_depth;
+
+	// fast skip support: handler interrupts the parser when it
+	// starts skipping, and the rest of the subtree is handled by
+	// the scanner
+	bool fast_skip_requested;
+	SkipScanner skip_scanner;
+
+	// path_prefix argument
+	Matcher matcher;
 
-	// pattern argument
-	PyObjList pattern;
+	// current path in json, and matcher state of each container in it
+	Path path;
+	SmallVector<int, 16> match_states;
+	int match_state;  // matcher state of the object being constructed
 
-	// current path in json
-	PyObjList path;
+	// makes output strings with resolved codec
+	Decoder decoder;
+
+	// shared decoded map keys (and short string values)
+	KeyCache key_cache;
 
 	// stack of objects being currently constructed
-	PyObjList constructing;
+	SmallVector<PyObjPtr, 16> constructing;
+
+	// JSON generator for raw output mode
+	yajl_gen raw_gen;
+
+	// map key for raw output, written only once it's known that its
+	// value is kept: with fields, a scalar whose key leads deeper into
+	// the projection is dropped, while a container is kept
+	std::string raw_pending_key;
+	bool raw_key_pending;
+
+	// fields argument, and its state for each constructed container
+	Projection projection;
+	SmallVector<Projection::Level, 16> projection_levels;
+	int next_field_node;  // projection node for value after map key
+
+	// where argument, evaluated on matched objects while they are parsed
+	Filter filter;
+
+	// aggregate() state; matched objects are not constructed while
+	// it's active
+	Aggregator aggregator;
+
+	// dump_ndjson() destination; matched values are written into it
+	// instead of being returned
+	OutputSink sink;
+
+	// build_index() state; matched values are recorded instead of
+	// being constructed while it's active
+	OffsetIndex offset_index;
+
+	// number of matched values to skip after seek()
+	uint64_t skip_matches;
 
 	// complete python objects ready to be returned to caller
-	PyObjList complete;
+	RingBuffer<PyObjPtr> complete;
+
+	// checkpoints argument state: offset preceding the value being
+	// matched, checkpoint for each object in complete queue, and the
+	// one following the last returned object
+	uint64_t match_offset;
+	RingBuffer<OffsetIndex::Checkpoint> complete_checkpoints;
+	OffsetIndex::Checkpoint checkpoint;
+
+	// error which interrupted filling a batch, raised on next call
+	PyObjPtr pending_error_type;
+	PyObjPtr pending_error_value;
+	PyObjPtr pending_error_traceback;
 };
 
+yajl_handle JsonSlicer_alloc_yajl(const yajl_callbacks* callbacks, void* ctx, int yajl_flags);
+yajl_handle JsonSlicer_alloc_parser(JsonSlicer* self, int yajl_flags);
+const yajl_callbacks* JsonSlicer_select_handlers(JsonSlicer* self, bool tracking_offsets);
+
 PyObject* JsonSlicer_new(PyTypeObject *type, PyObject *args, PyObject *kwds);
 void JsonSlicer_dealloc(JsonSlicer* self);
 int JsonSlicer_init(JsonSlicer* self, PyObject* args, PyObject* kwargs);
 
 JsonSlicer* JsonSlicer_iter(JsonSlicer* self);
 PyObject* JsonSlicer_iternext(JsonSlicer* self);
+PyObject* JsonSlicer_next_batch(JsonSlicer* self, PyObject* args);
+PyObject* JsonSlicer_collect(JsonSlicer* self, PyObject* args);
+PyObject* JsonSlicer_aggregate(JsonSlicer* self, PyObject* args, PyObject* kwargs);
+PyObject* JsonSlicer_dump_ndjson(JsonSlicer* self, PyObject* args);
+PyObject* JsonSlicer_build_index(JsonSlicer* self, PyObject* args, PyObject* kwargs);
+PyObject* JsonSlicer_seek(JsonSlicer* self, PyObject* args);
+PyObject* JsonSlicer_checkpoint(JsonSlicer* self, PyObject* args);
+PyObject* JsonSlicer_resume(JsonSlicer* self, PyObject* args);
+PyObject* JsonSlicer_get_stats(JsonSlicer* self, void* closure);
 
 extern PyTypeObject JsonSlicerType;
 
@@ -23,68 +23,179 @@
 #include "jsonslicer.hh"
 
 #include "handlers.hh"
-#include "encoding.hh"
 
 #include <Python.h>
+#include <yajl/yajl_gen.h>
 #include <yajl/yajl_parse.h>
 
 #include <new>
+#include <thread>
 
 PyObject* JsonSlicer_new(PyTypeObject* type, PyObject*, PyObject*) {
 	JsonSlicer* self = (JsonSlicer*)type->tp_alloc(type, 0);
 	if (self != nullptr) {
-		new(&self->io) PyObjPtr();
 		self->read_size = 1024;  // XXX: bump somewhat for production use
+		self->read_size_auto = false;
 		self->path_mode = JsonSlicer::PathMode::IGNORE;
-		new(&self->input_encoding) PyObjPtr();
-		new(&self->input_errors) PyObjPtr();
+		self->output_mode = JsonSlicer::OutputMode::OBJECTS;
 		new(&self->output_encoding) PyObjPtr();
 		new(&self->output_errors) PyObjPtr();
 		self->yajl_verbose_errors = 1;
+		self->yajl_flags = 0;
+		self->fast_skip = false;
+		self->pipelined = false;
+		self->threads = 0;
+		self->intern_values = false;
+		self->checkpoints = false;
+		self->timing = false;
+		self->raw_numbers = false;
+
+		new(&self->input) Input();
+		new(&self->read_size_tuner) ReadSizeTuner();
 
 		self->yajl = nullptr;
+		self->timed_handlers = nullptr;
+		new(&self->stats) Stats();
+		self->started = false;
+		self->parse_offset = 0;
+		self->event_end = 0;
+
+		new(&self->pipeline) Pipeline();
+		new(&self->parallel) ParallelParser();
 
 		new(&self->last_map_key) PyObjPtr();
 		self->state = JsonSlicer::State::SEEKING;
-
-		new(&self->pattern) PyObjList();
-		new(&self->path) PyObjList();
-		new(&self->constructing) PyObjList();
-		new(&self->complete) PyObjList();
+		self->skip_depth = 0;
+		self->fast_skip_requested = false;
+		new(&self->skip_scanner) SkipScanner();
+
+		new(&self->matcher) Matcher();
+		new(&self->path) Path();
+		new(&self->match_states) SmallVector<int, 16>();
+		self->match_state = Matcher::DEAD;
+		new(&self->decoder) Decoder();
+		new(&self->key_cache) KeyCache();
+		new(&self->constructing) SmallVector<PyObjPtr, 16>();
+		self->raw_gen = nullptr;
+		new(&self->raw_pending_key) std::string();
+		self->raw_key_pending = false;
+		new(&self->projection) Projection();
+		new(&self->projection_levels) SmallVector<Projection::Level, 16>();
+		self->next_field_node = Projection::WHOLE;
+		new(&self->filter) Filter();
+		new(&self->aggregator) Aggregator();
+		new(&self->sink) OutputSink();
+		new(&self->offset_index) OffsetIndex();
+		self->skip_matches = 0;
+		new(&self->complete) RingBuffer<PyObjPtr>();
+		self->match_offset = 0;
+		new(&self->complete_checkpoints) RingBuffer<OffsetIndex::Checkpoint>();
+		new(&self->checkpoint) OffsetIndex::Checkpoint();
+		new(&self->pending_error_type) PyObjPtr();
+		new(&self->pending_error_value) PyObjPtr();
+		new(&self->pending_error_traceback) PyObjPtr();
 	}
 	return (PyObject*)self;
 }
 
 void JsonSlicer_dealloc(JsonSlicer* self) {
-	self->complete.~PyObjList();
-	self->constructing.~PyObjList();
-	self->path.~PyObjList();
-	self->pattern.~PyObjList();
-
+	self->pending_error_traceback.~PyObjPtr();
+	self->pending_error_value.~PyObjPtr();
+	self->pending_error_type.~PyObjPtr();
+	self->checkpoint.~Checkpoint();
+	self->complete_checkpoints.~RingBuffer();
+	self->complete.~RingBuffer();
+	self->offset_index.~OffsetIndex();
+	self->sink.~OutputSink();
+	self->aggregator.~Aggregator();
+	self->filter.~Filter();
+	self->projection_levels.~SmallVector();
+	self->projection.~Projection();
+	self->raw_pending_key.~basic_string();
+	if (self->raw_gen != nullptr) {
+		yajl_gen_free(self->raw_gen);
+	}
+	self->constructing.~SmallVector();
+	self->key_cache.~KeyCache();
+	self->decoder.~Decoder();
+	self->match_states.~SmallVector();
+	self->path.~Path();
+	self->matcher.~Matcher();
+
+	self->skip_scanner.~SkipScanner();
 	self->last_map_key.~PyObjPtr();
 
+	self->parallel.~ParallelParser();
+	self->pipeline.~Pipeline();
+
+	self->stats.~Stats();
+
 	if (self->yajl != nullptr) {
 		yajl_handle tmp = self->yajl;
 		self->yajl = nullptr;
 		yajl_free(tmp);
 	}
 
+	self->read_size_tuner.~ReadSizeTuner();
+	self->input.~Input();
+
 	self->output_errors.~PyObjPtr();
 	self->output_encoding.~PyObjPtr();
-	self->input_errors.~PyObjPtr();
-	self->input_encoding.~PyObjPtr();
-
-	self->io.~PyObjPtr();
 
 	Py_TYPE(self)->tp_free((PyObject*)self);
 }
 
+yajl_handle JsonSlicer_alloc_yajl(const yajl_callbacks* callbacks, void* ctx, int yajl_flags) {
+	static const struct {
+		yajl_option option;
+		const char* name;
+	} options[] = {
+		{yajl_allow_comments, "yajl_allow_comments"},
+		{yajl_dont_validate_strings, "yajl_dont_validate_strings"},
+		{yajl_allow_trailing_garbage, "yajl_allow_trailing_garbage"},
+		{yajl_allow_multiple_values, "yajl_allow_multiple_values"},
+		{yajl_allow_partial_values, "yajl_allow_partial_values"},
+	};
+
+	yajl_handle handle = yajl_alloc(callbacks, nullptr, ctx);
+	if (handle == nullptr) {
+		PyErr_SetString(PyExc_RuntimeError, "Cannot allocate YAJL handle");
+		return nullptr;
+	}
+
+	for (const auto& option: options) {
+		if ((yajl_flags & option.option) && yajl_config(handle, option.option, 1) == 0) {
+			yajl_free(handle);
+			PyErr_Format(PyExc_RuntimeError, "Cannot set %s", option.name);
+			return nullptr;
+		}
+	}
+
+	return handle;
+}
+
+const yajl_callbacks* JsonSlicer_select_handlers(JsonSlicer* self, bool tracking_offsets) {
+	const yajl_callbacks* handlers = select_handlers(self->raw_numbers, tracking_offsets);
+	if (self->timing) {
+		self->timed_handlers = handlers;
+		return select_timed_handlers(self->raw_numbers);
+	}
+	return handlers;
+}
+
+yajl_handle JsonSlicer_alloc_parser(JsonSlicer* self, int yajl_flags) {
+	return JsonSlicer_alloc_yajl(JsonSlicer_select_handlers(self, self->offset_index.active() || self->checkpoints), (void*)self, yajl_flags);
+}
+
 int JsonSlicer_init(JsonSlicer* self, PyObject* args, PyObject* kwargs) {
 	// parse args
 	PyObject* io = nullptr;
 	PyObject* pattern = nullptr;
+	PyObject* read_size_arg = nullptr;
 	Py_ssize_t read_size = self->read_size;
+	int read_size_auto = self->read_size_auto;
 	JsonSlicer::PathMode path_mode = self->path_mode;
+	JsonSlicer::OutputMode output_mode = self->output_mode;
 	int enable_yajl_allow_comments = false;
 	int enable_yajl_dont_validate_strings = false;
 	int enable_yajl_allow_trailing_garbage = false;
@@ -93,6 +204,14 @@ int JsonSlicer_init(JsonSlicer* self, PyObject* args, PyObject* kwargs) {
 	PyObject* encoding = nullptr;
 	PyObject* errors = nullptr;
 	int binary = false;
+	int fast_skip = false;
+	int pipelined = false;
+	Py_ssize_t threads = 0;
+	int intern_values = false;
+	int checkpoints = false;
+	int timing = false;
+	PyObject* fields = nullptr;
+	PyObject* where = nullptr;
 
 	static const char* keywords[] = {
 		"file",
@@ -108,15 +227,25 @@ int JsonSlicer_init(JsonSlicer* self, PyObject* args, PyObject* kwargs) {
 		"encoding",
 		"errors",
 		"binary",
+		"fast_skip",
+		"pipelined",
+		"intern_values",
+		"fields",
+		"where",
+		"output",
+		"threads",
+		"checkpoints",
+		"timing",
 		nullptr
 	};
 
 	const char* path_mode_arg = nullptr;
+	const char* output_arg = nullptr;
 	if (!PyArg_ParseTupleAndKeywords(
-			args, kwargs, "OO|$nsppppppOOp", const_cast<char**>(keywords),
+			args, kwargs, "OO|$OsppppppOOppppOOsnpp", const_cast<char**>(keywords),
 			&io,
 			&pattern,
-			&read_size,
+			&read_size_arg,
 			&path_mode_arg,
 			&enable_yajl_allow_comments,
 			&enable_yajl_dont_validate_strings,
@@ -126,11 +255,72 @@ int JsonSlicer_init(JsonSlicer* self, PyObject* args, PyObject* kwargs) {
 			&self->yajl_verbose_errors,
 			&encoding,
 			&errors,
-			&binary
+			&binary,
+			&fast_skip,
+			&pipelined,
+			&intern_values,
+			&fields,
+			&where,
+			&output_arg,
+			&threads,
+			&checkpoints,
+			&timing
 		)) {
 		return -1;
 	}
 
+	if (threads < 0) {
+		PyErr_SetString(PyExc_ValueError, "Number of threads must not be negative");
+		return -1;
+	}
+
+	// more workers than hardware threads only compete for cores
+	Py_ssize_t hardware_threads = std::thread::hardware_concurrency();
+	if (hardware_threads > 0 && threads > hardware_threads) {
+		threads = hardware_threads;
+	}
+
+	// input which cannot be split is read by a single worker
+	bool parallel = threads > 0;
+	pipelined = pipelined || parallel;
+
+	if (read_size_arg) {
+		if (PyUnicode_Check(read_size_arg) && PyUnicode_CompareWithASCIIString(read_size_arg, "auto") == 0) {
+			read_size_auto = true;
+		} else if (PyLong_Check(read_size_arg)) {
+			read_size = PyLong_AsSsize_t(read_size_arg);
+			if (read_size == -1 && PyErr_Occurred()) {
+				return -1;
+			}
+			read_size_auto = false;
+		} else {
+			PyErr_SetString(PyExc_TypeError, "read_size must be an integer or 'auto'");
+			return -1;
+		}
+	}
+
+	// offsets are not known to the background tokenizer
+	if (checkpoints && pipelined) {
+		PyErr_SetString(PyExc_ValueError, "Checkpoints are not supported in pipelined mode");
+		return -1;
+	}
+
+	// small chunks would make parallel parsing pointless, so it
+	// uses 'auto' unless chunk size is specified explicitly
+	if (parallel && !read_size_arg) {
+		read_size_auto = true;
+	}
+
+	if (read_size_auto) {
+		// pipelined mode reads in another thread, so it gets a fixed
+		// chunk size instead of tuning
+		if (parallel) {
+			read_size = ReadSizeTuner::PARALLEL_SIZE;
+		} else {
+			read_size = pipelined ? ReadSizeTuner::PIPELINED_SIZE : ReadSizeTuner::INITIAL_SIZE;
+		}
+	}
+
 	if (path_mode_arg) {
 		if (strcmp(path_mode_arg, "ignore") == 0) {
 			path_mode = JsonSlicer::PathMode::IGNORE;
@@ -144,6 +334,17 @@ int JsonSlicer_init(JsonSlicer* self, PyObject* args, PyObject* kwargs) {
 		}
 	}
 
+	if (output_arg) {
+		if (strcmp(output_arg, "objects") == 0) {
+			output_mode = JsonSlicer::OutputMode::OBJECTS;
+		} else if (strcmp(output_arg, "raw") == 0) {
+			output_mode = JsonSlicer::OutputMode::RAW;
+		} else {
+			PyErr_SetString(PyExc_ValueError, "Bad value for output argument");
+			return -1;
+		}
+	}
+
 	assert(io != nullptr);
 	assert(pattern != nullptr);
 
@@ -194,70 +395,116 @@ int JsonSlicer_init(JsonSlicer* self, PyObject* args, PyObject* kwargs) {
 	}
 
 	// prepare all new data members
-	PyObjList new_pattern;
-
-	for (Py_ssize_t i = 0; i < PySequence_Size(pattern); i++) {
-		PyObjPtr item = PyObjPtr::Take(PySequence_GetItem(pattern, i));
-		if (item) {
-#ifdef USE_BYTES_INTERNALLY
-			item = encode(item, output_encoding, output_errors);
-#else // use output encoding internally
-			if (binary) {
-				item = encode(item, output_encoding, output_errors);
-			} else {
-				item = decode(item, output_encoding, output_errors);
-			}
-#endif
-		}
-		if (!item) {
-			return -1;
-		}
-		if (!new_pattern.push_back(item)) {
-			return -1;
-		}
+	Matcher new_matcher;
+	if (!new_matcher.compile(pattern, output_encoding, output_errors)) {
+		return -1;
 	}
 
-	yajl_handle new_yajl = yajl_alloc(&yajl_handlers, nullptr, (void*)self);
-	if (new_yajl == nullptr) {
-		PyErr_SetString(PyExc_RuntimeError, "Cannot allocate YAJL handle");
+	Projection new_projection;
+	if (!new_projection.compile(fields, output_encoding, output_errors)) {
 		return -1;
 	}
 
-	if (enable_yajl_allow_comments && yajl_config(new_yajl, yajl_allow_comments, 1) == 0) {
-		yajl_free(new_yajl);
-		PyErr_SetString(PyExc_RuntimeError, "Cannot set yajl_allow_comments");
+	Filter new_filter;
+	if (!new_filter.compile(where, output_encoding, output_errors)) {
 		return -1;
 	}
-	if (enable_yajl_dont_validate_strings && yajl_config(new_yajl, yajl_dont_validate_strings, 1) == 0) {
-		yajl_free(new_yajl);
-		PyErr_SetString(PyExc_RuntimeError, "Cannot set yajl_dont_validate_strings");
+
+	Decoder new_decoder;
+	if (!new_decoder.open(binary ? PyObjPtr() : output_encoding, output_errors)) {
 		return -1;
 	}
-	if (enable_yajl_allow_trailing_garbage && yajl_config(new_yajl, yajl_allow_trailing_garbage, 1) == 0) {
-		yajl_free(new_yajl);
-		PyErr_SetString(PyExc_RuntimeError, "Cannot set yajl_allow_trailing_garbage");
+
+	Input new_input;
+	if (!new_input.open(io, read_size, input_encoding, input_errors)) {
 		return -1;
 	}
-	if (enable_yajl_allow_multiple_values && yajl_config(new_yajl, yajl_allow_multiple_values, 1) == 0) {
-		yajl_free(new_yajl);
-		PyErr_SetString(PyExc_RuntimeError, "Cannot set yajl_allow_multiple_values");
+
+	if (pipelined && !new_input.is_native()) {
+		PyErr_SetString(PyExc_ValueError, "Pipelined mode requires file path or descriptor input");
 		return -1;
 	}
-	if (enable_yajl_allow_partial_values && yajl_config(new_yajl, yajl_allow_partial_values, 1) == 0) {
-		yajl_free(new_yajl);
-		PyErr_SetString(PyExc_RuntimeError, "Cannot set yajl_allow_partial_values");
+
+	if (parallel && !new_input.is_mapped()) {
+		if (PyErr_WarnEx(PyExc_RuntimeWarning, "Input cannot be memory mapped, so it is parsed as in pipelined mode", 1) == -1) {
+			return -1;
+		}
+		parallel = false;
+	}
+
+	int yajl_flags = 0;
+	if (enable_yajl_allow_comments) {
+		yajl_flags |= yajl_allow_comments;
+	}
+	if (enable_yajl_dont_validate_strings) {
+		yajl_flags |= yajl_dont_validate_strings;
+	}
+	if (enable_yajl_allow_trailing_garbage) {
+		yajl_flags |= yajl_allow_trailing_garbage;
+	}
+	if (enable_yajl_allow_multiple_values) {
+		yajl_flags |= yajl_allow_multiple_values;
+	}
+	if (enable_yajl_allow_partial_values) {
+		yajl_flags |= yajl_allow_partial_values;
+	}
+
+	yajl_gen new_gen = nullptr;
+	if (output_mode == JsonSlicer::OutputMode::RAW) {
+		new_gen = yajl_gen_alloc(nullptr);
+		if (new_gen == nullptr) {
+			PyErr_SetString(PyExc_RuntimeError, "Cannot allocate YAJL generator");
+			return -1;
+		}
+	}
+
+	const yajl_callbacks* handlers = select_handlers(output_mode == JsonSlicer::OutputMode::RAW, checkpoints);
+	yajl_handle new_yajl = JsonSlicer_alloc_yajl(timing ? select_timed_handlers(output_mode == JsonSlicer::OutputMode::RAW) : handlers, (void*)self, yajl_flags);
+	if (new_yajl == nullptr) {
+		if (new_gen != nullptr) {
+			yajl_gen_free(new_gen);
+		}
 		return -1;
 	}
 
 	// swap initialized members with new ones, clearing the rest
+	self->pending_error_type = {};
+	self->pending_error_value = {};
+	self->pending_error_traceback = {};
 	self->complete.clear();
+	self->complete_checkpoints.clear();
+	self->checkpoint = OffsetIndex::Checkpoint();
+	self->match_offset = 0;
 	self->constructing.clear();
+	self->projection_levels.clear();
+	self->next_field_node = Projection::WHOLE;
+	self->key_cache.clear();
 	self->path.clear();
-	self->pattern.swap(new_pattern);
+	self->match_states.clear();
+	self->match_state = Matcher::DEAD;
+	self->matcher.swap(new_matcher);
+	self->projection.swap(new_projection);
+	self->filter.swap(new_filter);
+	self->aggregator = Aggregator();
+	self->decoder.swap(new_decoder);
+	self->input.swap(new_input);
+	self->pipeline.close();
+	self->parallel.close();
+	self->sink.abandon();
+	self->offset_index = OffsetIndex();
+	self->skip_matches = 0;
+	self->started = false;
+	self->parse_offset = 0;
+	self->event_end = 0;
+	self->timed_handlers = handlers;
+	self->stats = Stats();
 
 	self->state = JsonSlicer::State::SEEKING;
+	self->skip_depth = 0;
+	self->fast_skip_requested = false;
+	self->skip_scanner.reset();
 
-	self->last_map_key.~PyObjPtr();
+	self->last_map_key = {};
 
 	{
 		yajl_handle tmp = self->yajl;
@@ -267,6 +514,14 @@ int JsonSlicer_init(JsonSlicer* self, PyObject* args, PyObject* kwargs) {
 		}
 	}
 
+	{
+		yajl_gen tmp = self->raw_gen;
+		self->raw_gen = new_gen;
+		if (tmp != nullptr) {
+			yajl_gen_free(tmp);
+		}
+	}
+
 	if (binary) {
 		// e.g. output is never decoded
 		self->output_errors = {};
@@ -275,12 +530,32 @@ int JsonSlicer_init(JsonSlicer* self, PyObject* args, PyObject* kwargs) {
 		self->output_errors = output_errors;
 		self->output_encoding = output_encoding;
 	}
-	self->input_errors = input_errors;
-	self->input_encoding = input_encoding;
 	self->path_mode = path_mode;
+	self->output_mode = output_mode;
+	self->raw_numbers = output_mode == JsonSlicer::OutputMode::RAW;
 	self->read_size = read_size;
+	self->read_size_auto = read_size_auto && !pipelined;
+	self->read_size_tuner.reset();
+	self->yajl_flags = yajl_flags;
+	// scanner does not know about comments, so they disable fast skip;
+	// it's also pointless in pipelined mode, as the worker tokenizes
+	// everything anyway
+	self->fast_skip = fast_skip && !enable_yajl_allow_comments && !pipelined;
+	self->pipelined = pipelined && !parallel;
+	self->threads = parallel ? threads : 0;
+	self->intern_values = intern_values;
+	self->checkpoints = checkpoints;
+	self->timing = timing;
+
+	if (self->pipelined && !self->pipeline.open(self->input, yajl_flags, self->yajl_verbose_errors, output_mode == JsonSlicer::OutputMode::RAW)) {
+		self->pipelined = false;
+		return -1;
+	}
 
-	self->io = PyObjPtr::Borrow(io);
+	if (self->threads > 0 && !self->parallel.open(self->input, threads, read_size, yajl_flags, self->yajl_verbose_errors, output_mode == JsonSlicer::OutputMode::RAW, self->matcher)) {
+		self->threads = 0;
+		return -1;
+	}
 
 	return 0;
 }
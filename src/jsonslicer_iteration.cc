@@ -22,11 +22,292 @@
 
 #include "jsonslicer.hh"
 
-#include "encoding.hh"
+#include "handlers.hh"
+#include "seek_handlers.hh"
 
 #include <Python.h>
+#include <yajl/yajl_gen.h>
 #include <yajl/yajl_parse.h>
 
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <string>
+
+static bool report_parser_error(JsonSlicer* self, yajl_status status, const unsigned char* data, size_t len) {
+	if (status == yajl_status_error) {
+		unsigned char* error = yajl_get_error(self->yajl, self->yajl_verbose_errors, data, len);
+		PyErr_Format(PyExc_RuntimeError, "YAJL error: %s", error);
+		yajl_free_error(self->yajl, error);
+	} // else it's interrupted parsing and PyErr is already set
+	return false;
+}
+
+// replaces the parser with a new one, fed with given synthetic JSON
+// text; the parser must be in SKIPPING state, so it does not produce
+// any output
+static bool replace_parser(JsonSlicer* self, const std::string& prefix) {
+	yajl_handle new_yajl = JsonSlicer_alloc_parser(self, self->yajl_flags);
+	if (new_yajl == nullptr) {
+		return false;
+	}
+
+	// synthetic events are not counted
+	Stats stats = self->stats;
+	yajl_status status = yajl_parse(new_yajl, reinterpret_cast<const unsigned char*>(prefix.data()), prefix.size());
+	std::copy(std::begin(stats.tokens), std::end(stats.tokens), self->stats.tokens);
+
+	std::swap(self->yajl, new_yajl);
+	yajl_free(new_yajl);
+
+	if (status != yajl_status_ok) {
+		return report_parser_error(self, status, reinterpret_cast<const unsigned char*>(prefix.data()), prefix.size());
+	}
+	return true;
+}
+
+// Parser state cannot be altered to skip part of input, so after
+// the skip is complete, the parser is replaced with a new one, which is
+// brought into the same state by feeding it with synthetic JSON text
+// which reproduces current path, followed by a dummy value in place of
+// the skipped one.
+static bool restart_parser(JsonSlicer* self) {
+	std::string prefix;
+	for (size_t i = 0; i < self->path.size(); i++) {
+		prefix += self->path.is_map(i) ? "{\"\":" : "[";
+	}
+	prefix += "null";
+
+	if (!replace_parser(self, prefix)) {
+		return false;
+	}
+
+	self->skip_scanner.reset();
+	self->state = JsonSlicer::State::SEEKING;
+	self->skip_depth = 0;
+	update_path(self);
+
+	return true;
+}
+
+// Parser is brought into the state it had right before the indexed
+// value, the same way as after fast skip. The offset points right
+// after the preceding event, which is the map key for map values, so
+// the innermost map gets no colon; for array values it's the previous
+// element, replaced with a dummy one, or the opening bracket.
+static bool resume_parser(JsonSlicer* self) {
+	std::string prefix;
+	for (size_t i = 0; i < self->path.size(); i++) {
+		bool innermost = i + 1 == self->path.size();
+		if (self->path.is_map(i)) {
+			prefix += innermost ? "{\"\"" : "{\"\":";
+		} else {
+			prefix += innermost && self->path.index(i) > 0 ? "[null" : "[";
+		}
+	}
+
+	self->state = JsonSlicer::State::SKIPPING;
+	self->skip_depth = 1;
+	if (!replace_parser(self, prefix)) {
+		return false;
+	}
+	self->state = JsonSlicer::State::SEEKING;
+	self->skip_depth = 0;
+	return true;
+}
+
+// feeds data at given input offset to the parser
+static bool feed_parser(JsonSlicer* self, const unsigned char* data, size_t len, uint64_t offset) {
+	while (true) {
+		if (self->skip_scanner.active()) {
+			size_t pos;
+			if (!self->skip_scanner.scan(data, len, &pos)) {
+				return true;
+			}
+			if (!restart_parser(self)) {
+				return false;
+			}
+			data += pos;
+			len -= pos;
+			offset += pos;
+
+			// end of skipped subtree is what precedes the next value
+			self->event_end = offset;
+		}
+
+		self->parse_offset = offset;
+		yajl_status status = yajl_parse(self->yajl, data, len);
+
+		if (status == yajl_status_client_canceled && self->fast_skip_requested) {
+			self->fast_skip_requested = false;
+			self->skip_scanner.start(self->skip_depth);
+
+			size_t consumed = yajl_get_bytes_consumed(self->yajl);
+			data += consumed;
+			len -= consumed;
+			offset += consumed;
+		} else if (status != yajl_status_ok) {
+			return report_parser_error(self, status, data, len);
+		} else {
+			return true;
+		}
+	}
+}
+
+static bool finish_parser(JsonSlicer* self) {
+	// input ended in the middle of skipped subtree; let the
+	// parser decide whether it's an error
+	if (self->skip_scanner.active() && !restart_parser(self)) {
+		return false;
+	}
+
+	self->parse_offset = self->input.position();
+	yajl_status status = yajl_complete_parse(self->yajl);
+	if (status != yajl_status_ok) {
+		return report_parser_error(self, status, nullptr, 0);
+	}
+	return true;
+}
+
+// reads next chunk of input and feeds it to the parser, or, in
+// pipelined and parallel modes, replays next batch of events prepared
+// by the workers
+static bool advance_parser(JsonSlicer* self, bool* eof) {
+	self->started = true;
+
+	if (self->pipelined || self->threads > 0) {
+		size_t input_size;
+		bool success;
+		if (self->pipelined) {
+			success = self->pipeline.next(JsonSlicer_select_handlers(self, false), self, eof, &input_size);
+		} else {
+			success = self->parallel.next(JsonSlicer_select_handlers(self, false), self, eof, &input_size);
+		}
+		if (input_size > 0) {
+			self->stats.add_chunk(input_size);
+		}
+		return success;
+	}
+
+	// read chunk of data from IO
+	const unsigned char* data;
+	size_t len;
+	uint64_t start = self->timing ? Stats::now() : 0;
+	if (!self->input.read(&data, &len)) {
+		return false;
+	}
+	if (self->timing) {
+		self->stats.read_ns += Stats::now() - start;
+	}
+
+	// advance or finalize parser; handlers are called from inside
+	// the parser, so their time is subtracted
+	uint64_t handlers_ns = self->stats.handlers_ns;
+	start = self->timing ? Stats::now() : 0;
+	bool success;
+	if (len == 0) {
+		*eof = true;
+		success = finish_parser(self);
+	} else {
+		self->stats.add_chunk(len);
+		success = feed_parser(self, data, len, self->input.position() - len);
+	}
+	if (self->timing) {
+		self->stats.parse_ns += (Stats::now() - start) - (self->stats.handlers_ns - handlers_ns);
+	}
+	if (!success || *eof) {
+		return success;
+	}
+
+	if (self->read_size_auto && self->read_size_tuner.update(self->complete.size())) {
+		return self->input.set_read_size(self->read_size_tuner.size());
+	}
+
+	return true;
+}
+
+// raises error deferred by previous batch call
+static bool check_pending_error(JsonSlicer* self) {
+	if (!self->pending_error_type) {
+		return true;
+	}
+	PyErr_Restore(
+		self->pending_error_type.release(),
+		self->pending_error_value ? self->pending_error_value.release() : nullptr,
+		self->pending_error_traceback ? self->pending_error_traceback.release() : nullptr
+	);
+	return false;
+}
+
+// takes the first complete object, moving checkpoint past it
+static PyObjPtr take_complete(JsonSlicer* self) {
+	self->stats.objects++;
+	if (self->checkpoints) {
+		self->checkpoint = self->complete_checkpoints.pop_front();
+	}
+	return self->complete.pop_front();
+}
+
+// moves up to limit complete objects into a new list, parsing more
+// input as needed
+static PyObject* take_objects(JsonSlicer* self, size_t limit) {
+	if (!check_pending_error(self)) {
+		return nullptr;
+	}
+
+	PyObjPtr result = PyObjPtr::Take(PyList_New(0));
+	if (!result) {
+		return nullptr;
+	}
+
+	bool eof = false;
+	size_t count = 0;
+
+	while (true) {
+		while (count < limit && !self->complete.empty()) {
+			if (PyList_Append(result.get(), take_complete(self).get()) == -1) {
+				return nullptr;
+			}
+			count++;
+		}
+
+		if (count == limit || eof) {
+			break;
+		}
+
+		if (!advance_parser(self, &eof)) {
+			if (count == 0) {
+				return nullptr;
+			}
+
+			// return what's already collected, and raise on next call
+			PyObject* type;
+			PyObject* value;
+			PyObject* traceback;
+			PyErr_Fetch(&type, &value, &traceback);
+			self->pending_error_type = PyObjPtr::Take(type);
+			self->pending_error_value = PyObjPtr::Take(value);
+			self->pending_error_traceback = PyObjPtr::Take(traceback);
+			break;
+		}
+	}
+
+	return result.release();
+}
+
+// checks that the rest of input may be consumed by a method which
+// changes how matched objects are handled
+static bool check_consuming_allowed(JsonSlicer* self, const char* method) {
+	// handlers may only be switched between top level values (or
+	// before anything is read, which may follow seek())
+	if (self->aggregator.active() || self->sink.active() || self->state != JsonSlicer::State::SEEKING || (self->started && !self->path.empty()) || !self->complete.empty()) {
+		PyErr_Format(PyExc_RuntimeError, "%s() must be called before iteration", method);
+		return false;
+	}
+
+	return check_pending_error(self);
+}
+
 JsonSlicer* JsonSlicer_iter(JsonSlicer* self) {
 	Py_INCREF(self);
 	return self;
@@ -35,55 +316,356 @@ JsonSlicer* JsonSlicer_iter(JsonSlicer* self) {
 PyObject* JsonSlicer_iternext(JsonSlicer* self) {
 	// return complete objects from previous runs, if any
 	if (!self->complete.empty()) {
-		return self->complete.pop_front().release();
+		return take_complete(self).release();
+	}
+
+	if (!check_pending_error(self)) {
+		return nullptr;
 	}
 
 	bool eof = false;
 
 	do {
-		// read chunk of data from IO
-		PyObjPtr buffer = PyObjPtr::Take(PyObject_CallMethod(self->io.get(), "read", "n", self->read_size));
+		if (!advance_parser(self, &eof)) {
+			return nullptr;
+		}
+
+		// return complete object, if any
+		if (!self->complete.empty()) {
+			return take_complete(self).release();
+		}
+	} while (!eof);
 
-		// handle i/o errors
-		if (!buffer) {
+	return nullptr;
+}
+
+PyObject* JsonSlicer_next_batch(JsonSlicer* self, PyObject* args) {
+	Py_ssize_t size;
+	if (!PyArg_ParseTuple(args, "n", &size)) {
+		return nullptr;
+	}
+	if (size <= 0) {
+		PyErr_SetString(PyExc_ValueError, "Batch size must be positive");
+		return nullptr;
+	}
+
+	return take_objects(self, size);
+}
+
+PyObject* JsonSlicer_collect(JsonSlicer* self, PyObject*) {
+	return take_objects(self, SIZE_MAX);
+}
+
+PyObject* JsonSlicer_aggregate(JsonSlicer* self, PyObject* args, PyObject* kwargs) {
+	int count = true;
+	PyObject* sum = nullptr;
+	PyObject* min = nullptr;
+	PyObject* max = nullptr;
+	PyObject* group_by = nullptr;
+
+	static const char* keywords[] = {
+		"count",
+		"sum",
+		"min",
+		"max",
+		"group_by",
+		nullptr
+	};
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|$pOOOO", const_cast<char**>(keywords), &count, &sum, &min, &max, &group_by)) {
+		return nullptr;
+	}
+
+	if (!check_consuming_allowed(self, "aggregate")) {
+		return nullptr;
+	}
+
+	// in binary mode, output encoding is not available, and field
+	// names are assumed to be UTF-8
+	PyObjPtr encoding = self->output_encoding;
+	PyObjPtr errors = self->output_errors;
+	if (!encoding) {
+		encoding = PyObjPtr::Take(PyUnicode_FromString("UTF-8"));
+		errors = PyObjPtr::Take(PyUnicode_FromString("strict"));
+		if (!encoding || !errors) {
 			return nullptr;
 		}
-		if (PyUnicode_Check(buffer.get())) {
-			PyObjPtr encoded = encode(buffer, self->input_encoding, self->input_errors);
-			if (!encoded) {
-				return nullptr;
-			}
-			buffer = encoded;
+	}
+
+	// nothing is constructed, fields are only visited by the filter
+	Projection projection;
+	PyObjPtr no_fields = PyObjPtr::Take(PyTuple_New(0));
+	if (!no_fields || !projection.compile(no_fields.get(), encoding, errors)) {
+		return nullptr;
+	}
+
+	Aggregator aggregator;
+	if (!aggregator.compile(count, sum, min, max, group_by, encoding, errors, self->filter)) {
+		return nullptr;
+	}
+
+	self->projection.swap(projection);
+	self->aggregator = aggregator;
+
+	bool eof = false;
+	while (!eof) {
+		if (!advance_parser(self, &eof)) {
+			return nullptr;
 		}
-		if (!PyBytes_Check(buffer.get())) {
-			PyErr_Format(PyExc_RuntimeError, "Unexpected read result type %s, expected bytes", buffer.get()->ob_type->tp_name);
+	}
+
+	return self->aggregator.result(self->decoder).release();
+}
+
+PyObject* JsonSlicer_dump_ndjson(JsonSlicer* self, PyObject* args) {
+	PyObject* io;
+	if (!PyArg_ParseTuple(args, "O", &io)) {
+		return nullptr;
+	}
+
+	if (!check_consuming_allowed(self, "dump_ndjson")) {
+		return nullptr;
+	}
+
+	// matched values are generated as in raw output mode
+	if (self->raw_gen == nullptr) {
+		self->raw_gen = yajl_gen_alloc(nullptr);
+		if (self->raw_gen == nullptr) {
+			PyErr_SetString(PyExc_RuntimeError, "Cannot allocate YAJL generator");
 			return nullptr;
 		}
+	}
 
-		// advance or finalize parser
-		yajl_status status;
-		if (PyBytes_GET_SIZE(buffer.get()) == 0) {
-			eof = true;
-			status = yajl_complete_parse(self->yajl);
+	// numbers are written as is, so the parser, which could only
+	// report them converted, is replaced; nothing may be parsed yet,
+	// but the parser may already be brought to a resumed position
+	if (!self->raw_numbers) {
+		if (self->started) {
+			PyErr_SetString(PyExc_RuntimeError, "dump_ndjson() must be called before iteration");
+			return nullptr;
+		}
+
+		self->raw_numbers = true;
+		bool success;
+		if (self->pipelined) {
+			success = self->pipeline.use_raw_numbers();
+		} else if (self->threads > 0) {
+			self->parallel.use_raw_numbers();
+			success = true;
 		} else {
-			status = yajl_parse(self->yajl, (const unsigned char*)PyBytes_AS_STRING(buffer.get()), PyBytes_GET_SIZE(buffer.get()));
+			success = resume_parser(self);
+		}
+		if (!success) {
+			self->raw_numbers = false;
+			return nullptr;
 		}
+	}
+
+	if (!self->sink.open(io)) {
+		return nullptr;
+	}
+
+	JsonSlicer::OutputMode output_mode = self->output_mode;
+	self->output_mode = JsonSlicer::OutputMode::RAW;
 
-		// handle parser errors
-		if (status != yajl_status_ok) {
-			if (status == yajl_status_error) {
-				unsigned char* error = yajl_get_error(self->yajl, self->yajl_verbose_errors, (const unsigned char*)PyBytes_AS_STRING(buffer.get()), PyBytes_GET_SIZE(buffer.get()));
-				PyErr_Format(PyExc_RuntimeError, "YAJL error: %s", error);
-				yajl_free_error(self->yajl, error);
-			} // else it's interrupted parsing and PyErr is already set
+	bool eof = false;
+	while (!eof) {
+		if (!advance_parser(self, &eof)) {
+			self->output_mode = output_mode;
+			self->sink.abandon();
 			return nullptr;
 		}
+	}
 
-		// return complete object, if any
-		if (!self->complete.empty()) {
-			return self->complete.pop_front().release();
+	self->output_mode = output_mode;
+
+	if (!self->sink.close()) {
+		return nullptr;
+	}
+
+	return Py_BuildValue("{s:n,s:n}", "objects", (Py_ssize_t)self->sink.lines(), "bytes", (Py_ssize_t)self->sink.bytes());
+}
+
+PyObject* JsonSlicer_build_index(JsonSlicer* self, PyObject* args, PyObject* kwargs) {
+	PyObject* io;
+	Py_ssize_t every = 1;
+
+	static const char* keywords[] = {
+		"file",
+		"every",
+		nullptr
+	};
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|$n", const_cast<char**>(keywords), &io, &every)) {
+		return nullptr;
+	}
+
+	if (every <= 0) {
+		PyErr_SetString(PyExc_ValueError, "every must be positive");
+		return nullptr;
+	}
+
+	// offsets are not known to the workers
+	if (self->pipelined || self->threads > 0) {
+		PyErr_SetString(PyExc_ValueError, "build_index() is not supported in pipelined mode");
+		return nullptr;
+	}
+
+	// parser is replaced with one which tracks offsets, so nothing
+	// may be read yet
+	if (self->started || self->skip_matches > 0) {
+		PyErr_SetString(PyExc_RuntimeError, "build_index() must be called before iteration");
+		return nullptr;
+	}
+
+	if (!check_consuming_allowed(self, "build_index")) {
+		return nullptr;
+	}
+
+	self->offset_index.start(every);
+
+	yajl_handle new_yajl = JsonSlicer_alloc_parser(self, self->yajl_flags);
+	if (new_yajl == nullptr) {
+		self->offset_index.stop();
+		return nullptr;
+	}
+	std::swap(self->yajl, new_yajl);
+	yajl_free(new_yajl);
+
+	bool eof = false;
+	while (!eof) {
+		if (!advance_parser(self, &eof)) {
+			self->offset_index.stop();
+			return nullptr;
 		}
-	} while (!eof);
+	}
 
-	return nullptr;
+	self->offset_index.stop();
+
+	if (!self->offset_index.save(io)) {
+		return nullptr;
+	}
+
+	return Py_BuildValue("{s:K,s:n}", "matches", (unsigned long long)self->offset_index.matches(), "entries", (Py_ssize_t)self->offset_index.size());
+}
+
+// recomputes matcher states of containers in the path
+static bool restore_match_states(JsonSlicer* self) {
+	self->match_states.clear();
+
+	int state = self->matcher.root();
+	for (size_t i = 0; i < self->path.size(); i++) {
+		if (i > 0) {
+			if (self->path.is_map(i - 1)) {
+				state = self->matcher.select_key(state, self->path.key_data(i - 1), self->path.key_size(i - 1));
+			} else {
+				state = self->matcher.select_index(state, self->path.index(i - 1));
+			}
+		}
+		if (!self->matcher.descends(state)) {
+			PyErr_SetString(PyExc_ValueError, "Offset index was built for different path pattern");
+			return false;
+		}
+		if (!self->match_states.push_back(state)) {
+			PyErr_NoMemory();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// checks that parsing may be moved to another position in input
+static bool check_resuming_allowed(JsonSlicer* self, const char* method) {
+	if (self->pipelined || self->threads > 0) {
+		PyErr_Format(PyExc_ValueError, "%s() is not supported in pipelined mode", method);
+		return false;
+	}
+
+	if (self->started || self->skip_matches > 0) {
+		PyErr_Format(PyExc_RuntimeError, "%s() must be called before iteration", method);
+		return false;
+	}
+
+	return check_consuming_allowed(self, method);
+}
+
+static bool resume_at(JsonSlicer* self, const OffsetIndex::Checkpoint& checkpoint) {
+	if (!OffsetIndex::restore_path(checkpoint.entry, self->path) || !restore_match_states(self) || !self->input.seek(checkpoint.entry.offset) || !resume_parser(self)) {
+		self->path.clear();
+		self->match_states.clear();
+		return false;
+	}
+
+	// the value may follow right away
+	self->event_end = checkpoint.entry.offset;
+	self->skip_matches = checkpoint.skip;
+	self->checkpoint = checkpoint;
+	return true;
+}
+
+PyObject* JsonSlicer_seek(JsonSlicer* self, PyObject* args) {
+	unsigned long long match;
+	PyObject* io;
+	if (!PyArg_ParseTuple(args, "KO", &match, &io)) {
+		return nullptr;
+	}
+
+	if (!check_resuming_allowed(self, "seek")) {
+		return nullptr;
+	}
+
+	OffsetIndex index;
+	if (!index.load(io)) {
+		return nullptr;
+	}
+
+	OffsetIndex::Checkpoint checkpoint;
+	uint64_t entry_match;
+	const OffsetIndex::Entry* entry = index.find(match, &entry_match);
+	if (entry == nullptr) {
+		// there are no matches at all
+		self->skip_matches = match;
+		self->checkpoint.skip = match;
+		Py_RETURN_NONE;
+	}
+
+	checkpoint.entry = *entry;
+	checkpoint.skip = match - entry_match;
+	if (!resume_at(self, checkpoint)) {
+		return nullptr;
+	}
+
+	Py_RETURN_NONE;
+}
+
+PyObject* JsonSlicer_checkpoint(JsonSlicer* self, PyObject*) {
+	if (!self->checkpoints) {
+		PyErr_SetString(PyExc_ValueError, "checkpoint() requires checkpoints argument");
+		return nullptr;
+	}
+
+	return OffsetIndex::dump_checkpoint(self->checkpoint);
+}
+
+PyObject* JsonSlicer_resume(JsonSlicer* self, PyObject* args) {
+	PyObject* data;
+	if (!PyArg_ParseTuple(args, "O", &data)) {
+		return nullptr;
+	}
+
+	if (!check_resuming_allowed(self, "resume")) {
+		return nullptr;
+	}
+
+	OffsetIndex::Checkpoint checkpoint;
+	if (!OffsetIndex::load_checkpoint(data, &checkpoint) || !resume_at(self, checkpoint)) {
+		return nullptr;
+	}
+
+	Py_RETURN_NONE;
+}
+
+PyObject* JsonSlicer_get_stats(JsonSlicer* self, void*) {
+	return self->stats.to_dict(self->timing);
 }
@@ -24,6 +24,23 @@
 
 #include <Python.h>
 
+static PyMethodDef JsonSlicer_methods[] = {
+	{"next_batch", (PyCFunction)JsonSlicer_next_batch, METH_VARARGS, "Return list of up to n next objects"},
+	{"collect", (PyCFunction)JsonSlicer_collect, METH_NOARGS, "Return list of all remaining objects"},
+	{"aggregate", (PyCFunction)(void(*)(void))JsonSlicer_aggregate, METH_VARARGS | METH_KEYWORDS, "Compute aggregates over all matched objects"},
+	{"dump_ndjson", (PyCFunction)JsonSlicer_dump_ndjson, METH_VARARGS, "Write all matched values into file as newline delimited JSON"},
+	{"build_index", (PyCFunction)(void(*)(void))JsonSlicer_build_index, METH_VARARGS | METH_KEYWORDS, "Save offsets of matched values into index file"},
+	{"seek", (PyCFunction)JsonSlicer_seek, METH_VARARGS, "Resume parsing at given match using index file"},
+	{"checkpoint", (PyCFunction)JsonSlicer_checkpoint, METH_NOARGS, "Return position following the last returned object"},
+	{"resume", (PyCFunction)JsonSlicer_resume, METH_VARARGS, "Resume parsing at position saved by checkpoint()"},
+	{nullptr, nullptr, 0, nullptr}
+};
+
+static PyGetSetDef JsonSlicer_getset[] = {
+	{const_cast<char*>("stats"), (getter)JsonSlicer_get_stats, nullptr, const_cast<char*>("Runtime counters"), nullptr},
+	{nullptr, nullptr, nullptr, nullptr, nullptr}
+};
+
 PyTypeObject JsonSlicerType = {
 	PyVarObject_HEAD_INIT(nullptr, 0)
 	"jsonslicer.JsonSlicer",   // tp_name
@@ -56,9 +73,9 @@ PyTypeObject JsonSlicerType = {
 	0,                         // tp_weaklistoffset
 	(getiterfunc)JsonSlicer_iter, // tp_iter
 	(iternextfunc)JsonSlicer_iternext, // tp_iternext
-	nullptr,                   // tp_methods
+	JsonSlicer_methods,        // tp_methods
 	nullptr,                   // tp_members
-	nullptr,                   // tp_getset
+	JsonSlicer_getset,         // tp_getset
 	nullptr,                   // tp_base
 	nullptr,                   // tp_dict
 	nullptr,                   // tp_descr_get
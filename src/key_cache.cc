@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "key_cache.hh"
+
+constexpr size_t KeyCache::NUM_SLOTS;
+constexpr size_t KeyCache::MAX_PROBES;
+constexpr size_t KeyCache::MAX_KEY_LENGTH;
+
+uint64_t KeyCache::hash(const char* data, size_t len) {
+	// FNV-1a
+	uint64_t h = 14695981039346656037ULL;
+	for (size_t i = 0; i < len; i++) {
+		h ^= static_cast<unsigned char>(data[i]);
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+PyObjPtr KeyCache::store(size_t slot, uint64_t hash, const char* data, size_t len, PyObjPtr object) {
+	// precompute hash, it's cached in str and bytes objects
+	if (PyObject_Hash(object.get()) == -1) {
+		return {};
+	}
+
+	if (slots_.empty()) {
+		slots_.resize(NUM_SLOTS);
+	}
+
+	Entry& entry = slots_[slot];
+	entry.hash = hash;
+	entry.data.assign(data, len);
+	entry.object = object;
+
+	return object;
+}
+
+void KeyCache::clear() {
+	slots_.clear();
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef JSONSLICER_KEY_CACHE_HH
+#define JSONSLICER_KEY_CACHE_HH
+
+#include "pyobjptr.hh"
+
+#include <Python.h>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Bounded cache which maps raw key bytes to ready to use (decoded
+// and hashed) python objects, so repeated map keys share a single
+// object, and dict insertions do not need to rehash them.
+//
+// Objects are not interned with PyUnicode_InternInPlace(), as on
+// some python versions it makes them immortal, and the cache may see
+// an unbounded number of distinct keys.
+//
+// This is an open addressing hash table of fixed size with short
+// linear probing; when all probed slots are taken, the home slot
+// is evicted.
+class KeyCache {
+public:
+	static constexpr size_t NUM_SLOTS = 1024;
+	static constexpr size_t MAX_PROBES = 4;
+	static constexpr size_t MAX_KEY_LENGTH = 64;
+
+private:
+	struct Entry {
+		uint64_t hash;
+		std::string data;
+		PyObjPtr object;
+	};
+
+private:
+	std::vector<Entry> slots_;
+
+private:
+	static uint64_t hash(const char* data, size_t len);
+
+	PyObjPtr store(size_t slot, uint64_t hash, const char* data, size_t len, PyObjPtr object);
+
+public:
+	void clear();
+
+	// returns cached object for given bytes, creating it with
+	// make() if it's not in the cache yet
+	template <class F>
+	PyObjPtr get(const char* data, size_t len, F&& make) {
+		if (len > MAX_KEY_LENGTH) {
+			return make();
+		}
+
+		uint64_t h = hash(data, len);
+		size_t home = h & (NUM_SLOTS - 1);
+		size_t slot = home;
+
+		if (!slots_.empty()) {
+			for (size_t i = 0; i < MAX_PROBES; i++) {
+				size_t pos = (home + i) & (NUM_SLOTS - 1);
+				Entry& entry = slots_[pos];
+				if (!entry.object) {
+					slot = pos;
+					break;
+				}
+				if (entry.hash == h && entry.data.size() == len && std::memcmp(entry.data.data(), data, len) == 0) {
+					return entry.object;
+				}
+			}
+		}
+
+		PyObjPtr object = make();
+		if (!object) {
+			return {};
+		}
+		return store(slot, h, data, len, object);
+	}
+};
+
+#endif
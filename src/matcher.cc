@@ -0,0 +1,315 @@
+/*
+ * Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "matcher.hh"
+
+#include <Python.h>
+
+#include <algorithm>
+#include <cstring>
+
+constexpr int Matcher::DEAD;
+constexpr int Matcher::UNKNOWN;
+constexpr size_t Matcher::LOOKUP_THRESHOLD;
+
+int Matcher::add_node() {
+	nodes_.emplace_back();
+	return nodes_.size() - 1;
+}
+
+int Matcher::key_child(int node, const std::string& key) {
+	for (const auto& child: nodes_[node].keys) {
+		if (child.first == key) {
+			return child.second;
+		}
+	}
+	int child = add_node();
+	nodes_[node].keys.emplace_back(key, child);
+	return child;
+}
+
+int Matcher::index_child(int node, size_t index) {
+	for (const auto& child: nodes_[node].indexes) {
+		if (child.first == index) {
+			return child.second;
+		}
+	}
+	int child = add_node();
+	nodes_[node].indexes.emplace_back(index, child);
+	return child;
+}
+
+int Matcher::wildcard_child(int node) {
+	if (nodes_[node].wildcard == -1) {
+		int child = add_node();
+		nodes_[node].wildcard = child;
+	}
+	return nodes_[node].wildcard;
+}
+
+int Matcher::any_depth_child(int node) {
+	if (nodes_[node].any_depth == -1) {
+		int child = add_node();
+		nodes_[child].loop = true;
+		nodes_[node].any_depth = child;
+	}
+	return nodes_[node].any_depth;
+}
+
+void Matcher::insert(const Pattern& pattern, int index) {
+	int node = 0;
+	for (size_t i = 0; i < pattern.size(); i++) {
+		switch (pattern[i].type) {
+		case PatternElement::Type::WILDCARD:
+			node = wildcard_child(node);
+			break;
+		case PatternElement::Type::KEY:
+			node = key_child(node, pattern[i].key);
+			break;
+		case PatternElement::Type::INDEX:
+			node = index_child(node, pattern[i].index);
+			break;
+		case PatternElement::Type::ANY_DEPTH:
+			node = any_depth_child(node);
+			break;
+		case PatternElement::Type::NEVER:
+			return;
+		}
+	}
+	nodes_[node].patterns.push_back(index);
+}
+
+// returns id of the state for given set of nodes, creating it if needed
+int Matcher::get_state(std::vector<int>& nodes) {
+	if (nodes.empty()) {
+		return DEAD;
+	}
+
+	// epsilon closure
+	for (size_t i = 0; i < nodes.size(); i++) {
+		if (nodes_[nodes[i]].any_depth != -1) {
+			nodes.push_back(nodes_[nodes[i]].any_depth);
+		}
+	}
+
+	std::sort(nodes.begin(), nodes.end());
+	nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+
+	auto found = state_ids_.find(nodes);
+	if (found != state_ids_.end()) {
+		return found->second;
+	}
+
+	State state;
+	state.nodes = nodes;
+
+	for (int node: nodes) {
+		const Node& trie_node = nodes_[node];
+		for (const auto& child: trie_node.keys) {
+			if (std::find_if(state.keys.begin(), state.keys.end(), [&child](const std::pair<std::string, int>& item) { return item.first == child.first; }) == state.keys.end()) {
+				state.keys.emplace_back(child.first, UNKNOWN);
+			}
+		}
+		for (const auto& child: trie_node.indexes) {
+			if (std::find_if(state.indexes.begin(), state.indexes.end(), [&child](const std::pair<size_t, int>& item) { return item.first == child.first; }) == state.indexes.end()) {
+				state.indexes.emplace_back(child.first, UNKNOWN);
+			}
+		}
+		state.patterns.insert(state.patterns.end(), trie_node.patterns.begin(), trie_node.patterns.end());
+		state.descends = state.descends || !trie_node.keys.empty() || !trie_node.indexes.empty() || trie_node.wildcard != -1 || trie_node.loop;
+	}
+
+	std::sort(state.patterns.begin(), state.patterns.end());
+	state.patterns.erase(std::unique(state.patterns.begin(), state.patterns.end()), state.patterns.end());
+
+	if (state.keys.size() > LOOKUP_THRESHOLD) {
+		for (size_t i = 0; i < state.keys.size(); i++) {
+			state.key_lookup.emplace(state.keys[i].first, i);
+		}
+	}
+	if (state.indexes.size() > LOOKUP_THRESHOLD) {
+		for (size_t i = 0; i < state.indexes.size(); i++) {
+			state.index_lookup.emplace(state.indexes[i].first, i);
+		}
+	}
+
+	int id = states_.size();
+	states_.push_back(std::move(state));
+	state_ids_.emplace(nodes, id);
+	return id;
+}
+
+// Targets are computed into local set first, as creating new state
+// invalidates references into states_
+
+int Matcher::key_target(int state, size_t pos) {
+	if (states_[state].keys[pos].second == UNKNOWN) {
+		std::vector<int> target;
+		const std::string& key = states_[state].keys[pos].first;
+		for (int node: states_[state].nodes) {
+			for (const auto& child: nodes_[node].keys) {
+				if (child.first == key) {
+					target.push_back(child.second);
+				}
+			}
+			if (nodes_[node].wildcard != -1) {
+				target.push_back(nodes_[node].wildcard);
+			}
+			if (nodes_[node].loop) {
+				target.push_back(node);
+			}
+		}
+		int id = get_state(target);
+		states_[state].keys[pos].second = id;
+	}
+	return states_[state].keys[pos].second;
+}
+
+int Matcher::index_target(int state, size_t pos) {
+	if (states_[state].indexes[pos].second == UNKNOWN) {
+		std::vector<int> target;
+		size_t index = states_[state].indexes[pos].first;
+		for (int node: states_[state].nodes) {
+			for (const auto& child: nodes_[node].indexes) {
+				if (child.first == index) {
+					target.push_back(child.second);
+				}
+			}
+			if (nodes_[node].wildcard != -1) {
+				target.push_back(nodes_[node].wildcard);
+			}
+			if (nodes_[node].loop) {
+				target.push_back(node);
+			}
+		}
+		int id = get_state(target);
+		states_[state].indexes[pos].second = id;
+	}
+	return states_[state].indexes[pos].second;
+}
+
+int Matcher::other_target(int state) {
+	if (states_[state].other == UNKNOWN) {
+		std::vector<int> target;
+		for (int node: states_[state].nodes) {
+			if (nodes_[node].wildcard != -1) {
+				target.push_back(nodes_[node].wildcard);
+			}
+			if (nodes_[node].loop) {
+				target.push_back(node);
+			}
+		}
+		int id = get_state(target);
+		states_[state].other = id;
+	}
+	return states_[state].other;
+}
+
+int Matcher::select_key(int state, const char* data, size_t len) {
+	if (state == DEAD) {
+		return DEAD;
+	}
+
+	const State& current = states_[state];
+	if (!current.key_lookup.empty()) {
+		lookup_key_.assign(data, len);
+		auto found = current.key_lookup.find(lookup_key_);
+		if (found != current.key_lookup.end()) {
+			return key_target(state, found->second);
+		}
+	} else {
+		for (size_t i = 0; i < current.keys.size(); i++) {
+			const std::string& key = current.keys[i].first;
+			if (key.size() == len && std::memcmp(key.data(), data, len) == 0) {
+				return key_target(state, i);
+			}
+		}
+	}
+	return other_target(state);
+}
+
+int Matcher::select_index(int state, size_t index) {
+	if (state == DEAD) {
+		return DEAD;
+	}
+
+	const State& current = states_[state];
+	if (!current.index_lookup.empty()) {
+		auto found = current.index_lookup.find(index);
+		if (found != current.index_lookup.end()) {
+			return index_target(state, found->second);
+		}
+	} else {
+		for (size_t i = 0; i < current.indexes.size(); i++) {
+			if (current.indexes[i].first == index) {
+				return index_target(state, i);
+			}
+		}
+	}
+	return other_target(state);
+}
+
+bool Matcher::compile(PyObject* path_prefix, PyObjPtr encoding, PyObjPtr errors) {
+	// list of tuples (or lists) is a set of patterns, anything else is
+	// a single pattern, as tuples are never valid path elements
+	bool multiple = PyList_Check(path_prefix) && PyList_GET_SIZE(path_prefix) > 0 &&
+		(PyTuple_Check(PyList_GET_ITEM(path_prefix, 0)) || PyList_Check(PyList_GET_ITEM(path_prefix, 0)));
+
+	std::vector<Pattern> patterns;
+	if (multiple) {
+		for (Py_ssize_t i = 0; i < PyList_GET_SIZE(path_prefix); i++) {
+			PyObject* item = PyList_GET_ITEM(path_prefix, i);
+			if (!PyTuple_Check(item) && !PyList_Check(item)) {
+				PyErr_SetString(PyExc_TypeError, "path_prefix items must be tuples");
+				return false;
+			}
+			patterns.emplace_back();
+			if (!patterns.back().compile(item, encoding, errors)) {
+				return false;
+			}
+		}
+	} else {
+		patterns.emplace_back();
+		if (!patterns.back().compile(path_prefix, encoding, errors)) {
+			return false;
+		}
+	}
+
+	Matcher matcher;
+	matcher.multiple_ = multiple;
+	matcher.add_node();
+	for (size_t i = 0; i < patterns.size(); i++) {
+		matcher.insert(patterns[i], i);
+	}
+
+	std::vector<int> root{0};
+	matcher.get_state(root);
+
+	swap(matcher);
+	return true;
+}
+
+void Matcher::swap(Matcher& other) {
+	nodes_.swap(other.nodes_);
+	states_.swap(other.states_);
+	state_ids_.swap(other.state_ids_);
+	std::swap(multiple_, other.multiple_);
+}
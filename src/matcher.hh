@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef JSONSLICER_MATCHER_HH
+#define JSONSLICER_MATCHER_HH
+
+#include "pattern.hh"
+#include "pyobjptr.hh"
+
+#include <Python.h>
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Set of path patterns, compiled into a trie of path elements which
+// is then matched as a DFA. Recursive wildcards make the trie an NFA,
+// with a looping node entered by an epsilon transition. DFA states
+// (sets of trie nodes which may match current position) and
+// transitions between them are built lazily, when first needed, so
+// only states reachable by the actual document are ever constructed,
+// and the cost of each step does not depend on the number of
+// patterns.
+//
+// Each container on the current path is associated with a state, and
+// the state of a value is derived from its container state and its
+// map key or array index. A value is matched if its state contains
+// any terminal nodes, and may contain matches if its state contains
+// any nodes with children.
+class Matcher {
+public:
+	static constexpr int DEAD = -1;
+
+private:
+	static constexpr int UNKNOWN = -2;
+
+	// states with more explicit transitions than that use hash lookup
+	static constexpr size_t LOOKUP_THRESHOLD = 8;
+
+	struct Node {
+		std::vector<std::pair<std::string, int>> keys;
+		std::vector<std::pair<size_t, int>> indexes;
+		int wildcard = -1;
+		int any_depth = -1;  // reached without consuming any elements
+		bool loop = false;   // any element leads back to this node
+		std::vector<int> patterns;  // indexes of patterns ending here
+	};
+
+	struct State {
+		std::vector<int> nodes;
+
+		// explicit transitions, with targets computed on first use
+		std::vector<std::pair<std::string, int>> keys;
+		std::vector<std::pair<size_t, int>> indexes;
+		std::unordered_map<std::string, size_t> key_lookup;
+		std::unordered_map<size_t, size_t> index_lookup;
+
+		// transition for keys and indexes not mentioned above
+		int other = UNKNOWN;
+
+		std::vector<int> patterns;
+		bool descends = false;
+	};
+
+private:
+	std::vector<Node> nodes_;
+	std::vector<State> states_;
+	std::map<std::vector<int>, int> state_ids_;
+	bool multiple_ = false;
+	std::string lookup_key_;
+
+private:
+	int add_node();
+	int key_child(int node, const std::string& key);
+	int index_child(int node, size_t index);
+	int wildcard_child(int node);
+	int any_depth_child(int node);
+
+	void insert(const Pattern& pattern, int index);
+
+	int get_state(std::vector<int>& nodes);
+	int key_target(int state, size_t pos);
+	int index_target(int state, size_t pos);
+	int other_target(int state);
+
+public:
+	// path_prefix is either a single sequence of path elements
+	// (str/bytes/int/None), or a list of such tuples
+	bool compile(PyObject* path_prefix, PyObjPtr encoding, PyObjPtr errors);
+
+	// whether multiple patterns were given, and matched objects
+	// should be accompanied by pattern indexes
+	bool multiple() const {
+		return multiple_;
+	}
+
+	// state for the top level value
+	int root() const {
+		return 0;
+	}
+
+	// given state of a container, return state of its value
+	int select_key(int state, const char* data, size_t len);
+	int select_index(int state, size_t index);
+
+	bool matches(int state) const {
+		return state != DEAD && !states_[state].patterns.empty();
+	}
+
+	bool descends(int state) const {
+		return state != DEAD && states_[state].descends;
+	}
+
+	// indexes of patterns matched by value with given state
+	const std::vector<int>& patterns(int state) const {
+		return states_[state].patterns;
+	}
+
+	void swap(Matcher& other);
+};
+
+#endif
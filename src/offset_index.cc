@@ -0,0 +1,245 @@
+/*
+ * Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "offset_index.hh"
+
+#include "input.hh"
+#include "output_sink.hh"
+
+#include <Python.h>
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+// file format, all integers are little endian:
+// - magic
+// - u64 every, u64 number of matches, u64 number of entries
+// - entries: u64 offset, u64 path size, path
+// - path levels: 'm', u64 key size, key; or 'a', u64 index
+//
+// checkpoint format:
+// - magic
+// - u64 offset, u64 matches to skip, path
+static const char MAGIC[8] = {'J', 'S', 'L', 'I', 'D', 'X', '\0', '\1'};
+static const char CHECKPOINT_MAGIC[8] = {'J', 'S', 'L', 'C', 'K', 'P', '\0', '\1'};
+
+static void put_u64(std::string& out, uint64_t value) {
+	for (int i = 0; i < 8; i++) {
+		out.push_back(static_cast<char>(value >> (i * 8)));
+	}
+}
+
+static bool get_u64(const std::string& in, size_t* pos, uint64_t* value) {
+	if (in.size() - *pos < 8) {
+		return false;
+	}
+	*value = 0;
+	for (int i = 0; i < 8; i++) {
+		*value |= static_cast<uint64_t>(static_cast<unsigned char>(in[*pos + i])) << (i * 8);
+	}
+	*pos += 8;
+	return true;
+}
+
+void OffsetIndex::start(uint64_t every) {
+	active_ = true;
+	every_ = every;
+	matches_ = 0;
+	entries_.clear();
+}
+
+void OffsetIndex::stop() {
+	active_ = false;
+}
+
+void OffsetIndex::add(const Path& path, uint64_t offset) {
+	if (matches_++ % every_ != 0) {
+		return;
+	}
+
+	entries_.emplace_back(make_entry(offset, path));
+}
+
+bool OffsetIndex::save(PyObject* file) const {
+	std::string data(MAGIC, sizeof(MAGIC));
+	put_u64(data, every_);
+	put_u64(data, matches_);
+	put_u64(data, entries_.size());
+
+	OutputSink sink;
+	if (!sink.open(file) || !sink.write(reinterpret_cast<const unsigned char*>(data.data()), data.size())) {
+		sink.abandon();
+		return false;
+	}
+
+	for (const Entry& entry: entries_) {
+		data.clear();
+		put_u64(data, entry.offset);
+		put_u64(data, entry.path.size());
+		data += entry.path;
+		if (!sink.write(reinterpret_cast<const unsigned char*>(data.data()), data.size())) {
+			sink.abandon();
+			return false;
+		}
+	}
+
+	return sink.close();
+}
+
+bool OffsetIndex::load(PyObject* file) {
+	Input input;
+	if (!input.open(file, 65536, {}, {})) {
+		return false;
+	}
+
+	std::string data;
+	while (true) {
+		const unsigned char* chunk;
+		size_t len;
+		if (!input.read(&chunk, &len)) {
+			return false;
+		}
+		if (len == 0) {
+			break;
+		}
+		data.append(reinterpret_cast<const char*>(chunk), len);
+	}
+
+	size_t pos = sizeof(MAGIC);
+	uint64_t every, matches, count;
+	if (data.size() < sizeof(MAGIC) || memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0 ||
+			!get_u64(data, &pos, &every) || !get_u64(data, &pos, &matches) || !get_u64(data, &pos, &count) || every == 0) {
+		PyErr_SetString(PyExc_ValueError, "Not an offset index file");
+		return false;
+	}
+
+	std::vector<Entry> entries;
+	for (uint64_t i = 0; i < count; i++) {
+		Entry entry;
+		uint64_t path_size;
+		if (!get_u64(data, &pos, &entry.offset) || !get_u64(data, &pos, &path_size) || data.size() - pos < path_size) {
+			PyErr_SetString(PyExc_ValueError, "Truncated offset index file");
+			return false;
+		}
+		entry.path.assign(data, pos, path_size);
+		pos += path_size;
+		entries.emplace_back(std::move(entry));
+	}
+
+	active_ = false;
+	every_ = every;
+	matches_ = matches;
+	entries_.swap(entries);
+	return true;
+}
+
+const OffsetIndex::Entry* OffsetIndex::find(uint64_t match, uint64_t* entry_match) const {
+	if (entries_.empty()) {
+		return nullptr;
+	}
+
+	uint64_t pos = std::min<uint64_t>(match / every_, entries_.size() - 1);
+	*entry_match = pos * every_;
+	return &entries_[pos];
+}
+
+OffsetIndex::Entry OffsetIndex::make_entry(uint64_t offset, const Path& path) {
+	Entry entry;
+	entry.offset = offset;
+	for (size_t i = 0; i < path.size(); i++) {
+		if (path.is_map(i)) {
+			entry.path.push_back('m');
+			put_u64(entry.path, path.key_size(i));
+			entry.path.append(path.key_data(i), path.key_size(i));
+		} else {
+			entry.path.push_back('a');
+			put_u64(entry.path, path.index(i));
+		}
+	}
+	return entry;
+}
+
+bool OffsetIndex::restore_path(const Entry& entry, Path& path) {
+	const std::string& data = entry.path;
+	path.clear();
+
+	size_t pos = 0;
+	while (pos < data.size()) {
+		char type = data[pos++];
+		uint64_t value;
+		if (!get_u64(data, &pos, &value)) {
+			break;
+		}
+
+		if (type == 'm' && data.size() - pos >= value) {
+			if (!path.push_map()) {
+				PyErr_NoMemory();
+				return false;
+			}
+			path.set_key(data.data() + pos, value);
+			pos += value;
+		} else if (type == 'a') {
+			if (!path.push_array()) {
+				PyErr_NoMemory();
+				return false;
+			}
+			path.set_index(value);
+		} else {
+			break;
+		}
+	}
+
+	if (pos != data.size()) {
+		PyErr_SetString(PyExc_ValueError, "Corrupt offset index entry");
+		return false;
+	}
+	return true;
+}
+
+PyObject* OffsetIndex::dump_checkpoint(const Checkpoint& checkpoint) {
+	std::string data(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+	put_u64(data, checkpoint.entry.offset);
+	put_u64(data, checkpoint.skip);
+	data += checkpoint.entry.path;
+
+	return PyBytes_FromStringAndSize(data.data(), data.size());
+}
+
+bool OffsetIndex::load_checkpoint(PyObject* data, Checkpoint* checkpoint) {
+	char* buf;
+	Py_ssize_t len;
+	if (PyBytes_AsStringAndSize(data, &buf, &len) == -1) {
+		return false;
+	}
+
+	std::string in(buf, len);
+	size_t pos = sizeof(CHECKPOINT_MAGIC);
+	if (in.size() < sizeof(CHECKPOINT_MAGIC) || memcmp(in.data(), CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0 ||
+			!get_u64(in, &pos, &checkpoint->entry.offset) || !get_u64(in, &pos, &checkpoint->skip)) {
+		PyErr_SetString(PyExc_ValueError, "Not a checkpoint");
+		return false;
+	}
+
+	checkpoint->entry.path.assign(in, pos, std::string::npos);
+	return true;
+}
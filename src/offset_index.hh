@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef JSONSLICER_OFFSET_INDEX_HH
+#define JSONSLICER_OFFSET_INDEX_HH
+
+#include "path.hh"
+
+#include <Python.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Byte offsets of matched values, which allow to resume parsing at any
+// of them without parsing anything before. Each entry holds the offset
+// of the end of parser event preceding the value (so it's followed by
+// optional whitespace and separator), and the path to the value, which
+// is needed to bring a new parser into the same state.
+//
+// Every Nth match is recorded, and the entries are saved into a
+// sidecar file, in a compact binary format.
+class OffsetIndex {
+public:
+	struct Entry {
+		uint64_t offset;
+		std::string path;  // serialized
+	};
+
+	// position from which parsing may be resumed, and number of
+	// matches to skip after it
+	struct Checkpoint {
+		Entry entry;
+		uint64_t skip = 0;
+	};
+
+private:
+	bool active_ = false;
+	uint64_t every_ = 1;
+	uint64_t matches_ = 0;
+	std::vector<Entry> entries_;
+
+public:
+	// starts recording every Nth match
+	void start(uint64_t every);
+	void stop();
+
+	bool active() const {
+		return active_;
+	}
+
+	// counts a match at given path, which follows parser event ending
+	// at given offset, and records it if needed
+	void add(const Path& path, uint64_t offset);
+
+	uint64_t matches() const {
+		return matches_;
+	}
+
+	size_t size() const {
+		return entries_.size();
+	}
+
+	// file may be a path, a descriptor, or a binary file object
+	bool save(PyObject* file) const;
+	bool load(PyObject* file);
+
+	// finds the last entry for a match not after the given one, and
+	// its match number; returns nullptr if there are no such entries
+	const Entry* find(uint64_t match, uint64_t* entry_match) const;
+
+	static Entry make_entry(uint64_t offset, const Path& path);
+	static bool restore_path(const Entry& entry, Path& path);
+
+	// checkpoints are serialized into bytes objects
+	static PyObject* dump_checkpoint(const Checkpoint& checkpoint);
+	static bool load_checkpoint(PyObject* data, Checkpoint* checkpoint);
+};
+
+#endif
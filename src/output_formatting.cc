@@ -22,57 +22,62 @@
 
 #include "output_formatting.hh"
 
-#include "encoding.hh"
-#include "pyobjlist.hh"
-#include "pymutindex.hh"
+#include "construct_handlers.hh"
+
+static PyObjPtr make_key(JsonSlicer* self, size_t pos) {
+	return make_map_key(self, self->path.key_data(pos), self->path.key_size(pos));
+}
+
+PyObjPtr generate_output_object(JsonSlicer* self, PyObjPtr obj, int pattern_index) {
+	size_t path_offset = pattern_index >= 0 ? 1 : 0;
+	size_t path_length;
 
-PyObjPtr generate_output_object(JsonSlicer* self, PyObjPtr obj) {
 	if (self->path_mode == JsonSlicer::PathMode::IGNORE) {
-		return obj;
+		path_length = 0;
 	} else if (self->path_mode == JsonSlicer::PathMode::MAP_KEYS) {
-		if (self->path.empty() || (!PyBytes_Check(self->path.back().get()) && !PyUnicode_Check(self->path.back().get()))) {
-			return obj;
-		} else {
-			PyObjPtr tuple = PyObjPtr::Take(PyTuple_New(2));
-			if (!tuple.valid()) {
-				return {};
-			}
-			PyObjPtr pathel = decode(self->path.back(), self->output_encoding, self->output_errors);
-			if (!pathel) {
-				return {};
-			}
-			PyTuple_SET_ITEM(tuple.get(), 0, pathel.getref());
-			PyTuple_SET_ITEM(tuple.get(), 1, obj.getref());
-			return tuple;
-		}
+		path_length = self->path.is_top_map() ? 1 : 0;
 	} else if (self->path_mode == JsonSlicer::PathMode::FULL) {
-		PyObjPtr tuple = PyObjPtr::Take(PyTuple_New(self->path.size() + 1));
-		if (!tuple.valid()) {
+		path_length = self->path.size();
+	} else {
+		PyErr_SetString(PyExc_RuntimeError, "Unexpected path mode");
+		return {};
+	}
+
+	// full mode always produces a tuple, even for top level object
+	if (path_offset + path_length == 0 && self->path_mode != JsonSlicer::PathMode::FULL) {
+		return obj;
+	}
+
+	PyObjPtr tuple = PyObjPtr::Take(PyTuple_New(path_offset + path_length + 1));
+	if (!tuple.valid()) {
+		return {};
+	}
+
+	if (pattern_index >= 0) {
+		PyObjPtr index = PyObjPtr::Take(PyLong_FromLong(pattern_index));
+		if (!index) {
 			return {};
 		}
+		PyTuple_SET_ITEM(tuple.get(), 0, index.getref());
+	}
 
-		size_t tuple_idx = 0;
-		for (auto pathel: self->path) {
-			if (PyMutIndex_Check(pathel.get())) {
-				PyObjPtr index = PyObjPtr::Take(PyMutIndex_AsPyLong(pathel.get()));
-				if (!index.valid()) {
-					return {};
-				}
-				PyTuple_SET_ITEM(tuple.get(), tuple_idx++, index.getref());
-			} else {
-				pathel = decode(pathel, self->output_encoding, self->output_errors);
-				if (!pathel) {
-					return {};
-				}
-				PyTuple_SET_ITEM(tuple.get(), tuple_idx++, pathel.getref());
-			}
+	// in map keys mode, only the last path element is output
+	size_t first = self->path.size() - path_length;
+	for (size_t i = 0; i < path_length; i++) {
+		size_t pos = first + i;
+		PyObjPtr pathel;
+		if (self->path.is_map(pos)) {
+			pathel = make_key(self, pos);
+		} else {
+			pathel = PyObjPtr::Take(PyLong_FromSize_t(self->path.index(pos)));
 		}
+		if (!pathel) {
+			return {};
+		}
+		PyTuple_SET_ITEM(tuple.get(), path_offset + i, pathel.getref());
+	}
 
-		PyTuple_SET_ITEM(tuple.get(), tuple_idx, obj.getref());
+	PyTuple_SET_ITEM(tuple.get(), path_offset + path_length, obj.getref());
 
-		return tuple;
-	} else {
-		PyErr_SetString(PyExc_RuntimeError, "Unexpected path mode");
-		return {};
-	}
+	return tuple;
 }
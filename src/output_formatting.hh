@@ -27,6 +27,7 @@
 
 #include <Python.h>
 
-PyObjPtr generate_output_object(JsonSlicer* self, PyObjPtr obj);
+// pattern_index is prepended to the output unless negative
+PyObjPtr generate_output_object(JsonSlicer* self, PyObjPtr obj, int pattern_index);
 
 #endif
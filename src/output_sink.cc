@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "output_sink.hh"
+
+#include <Python.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+
+#ifndef O_CLOEXEC
+# define O_CLOEXEC 0
+#endif
+
+constexpr size_t OutputSink::BUFFER_SIZE;
+
+OutputSink::~OutputSink() {
+	abandon();
+}
+
+void OutputSink::abandon() {
+	if (owns_fd_ && fd_ != -1) {
+		::close(fd_);
+	}
+	fd_ = -1;
+	owns_fd_ = false;
+	write_method_ = {};
+	buffer_.clear();
+	type_ = Type::NONE;
+}
+
+bool OutputSink::open(PyObject* io) {
+	abandon();
+	lines_ = 0;
+	bytes_ = 0;
+
+	if (PyLong_Check(io)) {
+		int fd = PyObject_AsFileDescriptor(io);
+		if (fd == -1) {
+			return false;
+		}
+		fd_ = fd;
+		type_ = Type::DESCRIPTOR;
+	} else if (PyUnicode_Check(io) || PyBytes_Check(io) || PyObject_HasAttrString(io, "__fspath__")) {
+		PyObject* path_raw = nullptr;
+		if (!PyUnicode_FSConverter(io, &path_raw)) {
+			return false;
+		}
+		PyObjPtr path = PyObjPtr::Take(path_raw);
+
+		const char* path_str = PyBytes_AS_STRING(path.get());
+		int fd;
+		do {
+			Py_BEGIN_ALLOW_THREADS
+			fd = ::open(path_str, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+			Py_END_ALLOW_THREADS
+		} while (fd == -1 && errno == EINTR && PyErr_CheckSignals() == 0);
+
+		if (fd == -1) {
+			if (!PyErr_Occurred()) {
+				PyErr_SetFromErrnoWithFilenameObject(PyExc_OSError, io);
+			}
+			return false;
+		}
+		fd_ = fd;
+		owns_fd_ = true;
+		type_ = Type::DESCRIPTOR;
+	} else {
+		write_method_ = PyObjPtr::Take(PyObject_GetAttrString(io, "write"));
+		if (!write_method_) {
+			return false;
+		}
+		type_ = Type::PYTHON;
+	}
+
+	buffer_.reserve(BUFFER_SIZE);
+	return true;
+}
+
+bool OutputSink::close() {
+	bool success = flush();
+	if (success && owns_fd_) {
+		int res = ::close(fd_);
+		owns_fd_ = false;
+		if (res == -1 && errno != EINTR) {
+			PyErr_SetFromErrno(PyExc_OSError);
+			success = false;
+		}
+	}
+	abandon();
+	return success;
+}
+
+bool OutputSink::write(const unsigned char* data, size_t len) {
+	buffer_.append(reinterpret_cast<const char*>(data), len);
+	bytes_ += len;
+
+	return buffer_.size() < BUFFER_SIZE || flush();
+}
+
+bool OutputSink::write_line(const unsigned char* data, size_t len) {
+	buffer_.append(reinterpret_cast<const char*>(data), len);
+	buffer_.push_back('\n');
+	lines_++;
+	bytes_ += len + 1;
+
+	return buffer_.size() < BUFFER_SIZE || flush();
+}
+
+bool OutputSink::flush() {
+	if (buffer_.empty()) {
+		return true;
+	}
+
+	bool success = type_ == Type::DESCRIPTOR ? write_descriptor() : write_python();
+	buffer_.clear();
+	return success;
+}
+
+bool OutputSink::write_python() {
+	PyObjPtr data = PyObjPtr::Take(PyBytes_FromStringAndSize(buffer_.data(), buffer_.size()));
+	if (!data) {
+		return false;
+	}
+
+	PyObjPtr result = PyObjPtr::Take(PyObject_CallFunctionObjArgs(write_method_.get(), data.get(), nullptr));
+	return result.valid();
+}
+
+bool OutputSink::write_descriptor() {
+	const char* data = buffer_.data();
+	size_t remaining = buffer_.size();
+
+	while (remaining > 0) {
+		ssize_t written;
+		Py_BEGIN_ALLOW_THREADS
+		written = ::write(fd_, data, remaining);
+		Py_END_ALLOW_THREADS
+
+		if (written == -1) {
+			if (errno == EINTR && PyErr_CheckSignals() == 0) {
+				continue;
+			}
+			if (!PyErr_Occurred()) {
+				PyErr_SetFromErrno(PyExc_OSError);
+			}
+			return false;
+		}
+
+		data += written;
+		remaining -= written;
+	}
+
+	return true;
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef JSONSLICER_OUTPUT_SINK_HH
+#define JSONSLICER_OUTPUT_SINK_HH
+
+#include "pyobjptr.hh"
+
+#include <Python.h>
+
+#include <string>
+
+// Writes newline delimited values into output, which may be:
+// - file path or file descriptor. Data is accumulated into a buffer
+//   which is written with write(2) without holding the GIL
+// - python binary file-like object, whose write() is called with
+//   each full buffer
+class OutputSink {
+private:
+	enum class Type {
+		NONE,
+		PYTHON,
+		DESCRIPTOR,
+	};
+
+	static constexpr size_t BUFFER_SIZE = 65536;
+
+private:
+	Type type_ = Type::NONE;
+
+	// python file-like object
+	PyObjPtr write_method_;
+
+	// file descriptor
+	int fd_ = -1;
+	bool owns_fd_ = false;
+
+	std::string buffer_;
+
+	size_t lines_ = 0;
+	size_t bytes_ = 0;
+
+private:
+	bool flush();
+	bool write_python();
+	bool write_descriptor();
+
+public:
+	OutputSink() = default;
+	~OutputSink();
+
+	OutputSink(const OutputSink&) = delete;
+	OutputSink& operator=(const OutputSink&) = delete;
+
+	bool open(PyObject* io);
+
+	// flushes remaining data and closes the output; statistics are
+	// kept until next open()
+	bool close();
+
+	// closes the output, discarding buffered data
+	void abandon();
+
+	bool active() const {
+		return type_ != Type::NONE;
+	}
+
+	bool write(const unsigned char* data, size_t len);
+
+	// appends value followed by newline
+	bool write_line(const unsigned char* data, size_t len);
+
+	size_t lines() const {
+		return lines_;
+	}
+
+	size_t bytes() const {
+		return bytes_;
+	}
+};
+
+#endif
@@ -0,0 +1,273 @@
+/*
+ * Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "parallel_parser.hh"
+
+#include <Python.h>
+#include <yajl/yajl_parse.h>
+
+#include <algorithm>
+#include <cassert>
+
+ParallelParser::~ParallelParser() {
+	close();
+}
+
+bool ParallelParser::open(Input& input, size_t num_threads, size_t segment_size, int yajl_flags, int verbose_errors, bool raw_numbers, Matcher& matcher) {
+	close();
+
+	if (!input.is_mapped()) {
+		PyErr_SetString(PyExc_ValueError, "Parallel parsing requires memory mapped input");
+		return false;
+	}
+
+	input_.swap(input);
+	yajl_flags_ = yajl_flags;
+	verbose_errors_ = verbose_errors;
+	raw_numbers_ = raw_numbers;
+	segment_size_ = segment_size;
+	num_threads_ = num_threads;
+	matcher_ = &matcher;
+
+	stop_ = false;
+	finished_ = false;
+	error_.clear();
+	// scanner does not know about comments, so such input is not split
+	splitter_.reset(input_.mapped_data(), input_.mapped_size(), !(yajl_flags & yajl_allow_comments));
+	jobs_ = std::vector<Job>(num_threads * 2);
+	head_ = 0;
+	next_ = 0;
+
+	return true;
+}
+
+void ParallelParser::close() {
+	if (!threads_.empty()) {
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stop_ = true;
+		}
+		slot_free_.notify_all();
+
+		for (auto& thread: threads_) {
+			thread.join();
+		}
+		threads_.clear();
+	}
+
+	Input empty;
+	input_.swap(empty);
+
+	jobs_.clear();
+}
+
+void ParallelParser::use_raw_numbers() {
+	assert(threads_.empty());
+	raw_numbers_ = true;
+}
+
+bool ParallelParser::active() const {
+	return !jobs_.empty();
+}
+
+void ParallelParser::run() {
+	while (true) {
+		Job* job;
+		size_t begin, end;
+
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			slot_free_.wait(lock, [this]{ return stop_ || splitter_.done() || next_ - head_ < jobs_.size(); });
+			if (stop_ || splitter_.done()) {
+				return;
+			}
+
+			job = &jobs_[next_++ % jobs_.size()];
+			splitter_.next(segment_size_, &begin, &end);
+			job->last = splitter_.done();
+		}
+
+		tokenize(*job, begin, end);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			job->ready = true;
+		}
+		job_ready_.notify_one();
+	}
+}
+
+// segment is parsed by a parser of its own; segments in the middle
+// are wrapped into an array, so they are valid JSON, the first one
+// is followed by closing brackets for the array and maps it's nested
+// in, and the last one is preceded by the opening ones
+void ParallelParser::tokenize(Job& job, size_t begin, size_t end) {
+	static const unsigned char open_bracket = '[';
+	static const unsigned char close_bracket = ']';
+
+	Batch& batch = job.batch;
+	batch.clear();
+
+	Pipeline::Recorder recorder;
+	recorder.batch = &batch;
+
+	// this runs without the GIL, so the handle is not allocated with
+	// JsonSlicer_alloc_yajl() which reports errors to Python; options
+	// were already validated by the main thread
+	yajl_handle yajl = yajl_alloc(raw_numbers_ ? &Pipeline::Recorder::number_handlers : &Pipeline::Recorder::handlers, nullptr, &recorder);
+	if (yajl == nullptr) {
+		batch.parser_error = "Cannot allocate YAJL handle";
+		batch.eof = true;
+		return;
+	}
+	for (int option = 1; option <= yajl_flags_; option <<= 1) {
+		if (yajl_flags_ & option) {
+			yajl_config(yajl, static_cast<yajl_option>(option), 1);
+		}
+	}
+
+	const unsigned char* data = input_.mapped_data() + begin;
+	size_t len = end - begin;
+	batch.input_size = job.last ? len : len + 1;  // with separator
+	bool first = begin == 0;
+
+	const unsigned char* failed_data = nullptr;
+	size_t failed_len = 0;
+	yajl_status status = yajl_status_ok;
+
+	// each enclosing map is entered with start and key events, and
+	// left with end one
+	const unsigned char* prefix = nullptr;
+	size_t prefix_len = 0;
+	const unsigned char* suffix = nullptr;
+	size_t suffix_len = 0;
+	size_t suffix_events = 0;
+	if (!first) {
+		prefix = job.last ? reinterpret_cast<const unsigned char*>(enter_array_.data()) : &open_bracket;
+		prefix_len = job.last ? enter_array_.size() : 1;
+		job.first_event = job.last ? 1 + 2 * splitter_.enclosing_maps() : 1;
+	} else {
+		job.first_event = 0;
+	}
+	if (!job.last) {
+		suffix = first ? reinterpret_cast<const unsigned char*>(leave_array_.data()) : &close_bracket;
+		suffix_len = first ? leave_array_.size() : 1;
+		suffix_events = first ? 1 + splitter_.enclosing_maps() : 1;
+	}
+
+	if (prefix_len > 0) {
+		status = yajl_parse(yajl, prefix, prefix_len);
+		failed_data = prefix;
+		failed_len = prefix_len;
+	}
+	if (status == yajl_status_ok) {
+		status = yajl_parse(yajl, data, len);
+		failed_data = data;
+		failed_len = len;
+	}
+	if (status == yajl_status_ok && suffix_len > 0) {
+		status = yajl_parse(yajl, suffix, suffix_len);
+		failed_data = suffix;
+		failed_len = suffix_len;
+	}
+	if (status == yajl_status_ok) {
+		status = yajl_complete_parse(yajl);
+		failed_data = nullptr;
+		failed_len = 0;
+	}
+
+	job.last_event = batch.events.size() - std::min(suffix_events, batch.events.size());
+
+	if (status != yajl_status_ok) {
+		// tape handlers never cancel parsing, so this is an error;
+		// events recorded before it are still replayed
+		unsigned char* error = yajl_get_error(yajl, verbose_errors_, failed_data, failed_len);
+		batch.parser_error = reinterpret_cast<const char*>(error);
+		yajl_free_error(yajl, error);
+		batch.eof = true;
+		job.last_event = batch.events.size();
+	}
+
+	job.first_event = std::min(job.first_event, job.last_event);
+
+	yajl_free(yajl);
+}
+
+bool ParallelParser::next(const yajl_callbacks* callbacks, void* ctx, bool* eof, size_t* input_size) {
+	*input_size = 0;
+	if (error_.active()) {
+		return error_.raise();
+	}
+	if (finished_) {
+		*eof = true;
+		return true;
+	}
+
+	if (threads_.empty()) {
+		if (!splitter_.locate(*matcher_) && PyErr_WarnEx(PyExc_RuntimeWarning, "Input cannot be split between threads, so it is parsed as in pipelined mode", 1) == -1) {
+			return error_.save();
+		}
+
+		enter_array_.clear();
+		leave_array_ = "]";
+		for (size_t i = 0; i < splitter_.enclosing_maps(); i++) {
+			enter_array_ += "{\"\":";
+			leave_array_ += "}";
+		}
+		enter_array_ += "[";
+
+		for (size_t i = 0; i < num_threads_; i++) {
+			threads_.emplace_back(&ParallelParser::run, this);
+		}
+	}
+
+	Job* job;
+	Py_BEGIN_ALLOW_THREADS
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		job = &jobs_[head_ % jobs_.size()];
+		job_ready_.wait(lock, [job]{ return job->ready; });
+	}
+	Py_END_ALLOW_THREADS
+
+	*input_size = job->batch.input_size;
+	bool success = job->batch.replay(callbacks, ctx, job->first_event, job->last_event) && job->batch.check_error();
+
+	if (job->last || job->batch.eof) {
+		// workers are done, or the rest of input is of no interest
+		finished_ = true;
+		*eof = true;
+	} else {
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			job->ready = false;
+			head_++;
+		}
+		slot_free_.notify_all();
+	}
+
+	if (!success) {
+		// events after the failed one are never replayed
+		return error_.save();
+	}
+	return true;
+}
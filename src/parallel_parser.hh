@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef JSONSLICER_PARALLEL_PARSER_HH
+#define JSONSLICER_PARALLEL_PARSER_HH
+
+#include "array_splitter.hh"
+#include "input.hh"
+#include "matcher.hh"
+#include "pipeline.hh"
+
+#include <Python.h>
+#include <yajl/yajl_parse.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Parses memory mapped input which contains a large array (at top
+// level or under map keys leading to matches) with a pool of worker
+// threads. Workers take turns splitting the array into segments at
+// element boundaries, and tokenize segments into tapes concurrently,
+// each wrapped into its own array (the last one also into enclosing
+// maps). Tapes are then replayed into the real handlers by the main
+// thread in input order, with wrapping events dropped, so handlers
+// see the same events as for the whole input.
+//
+// Number of tapes in flight is bounded, so the workers never get
+// too far ahead of the consumer.
+class ParallelParser {
+private:
+	typedef Pipeline::Batch Batch;
+	typedef Pipeline::StickyError StickyError;
+
+	struct Job {
+		Batch batch;
+		size_t first_event = 0;  // range of events to replay
+		size_t last_event = 0;
+		bool last = false;
+		bool ready = false;
+	};
+
+private:
+	Input input_;
+	int yajl_flags_ = 0;
+	int verbose_errors_ = 0;
+	bool raw_numbers_ = false;
+	size_t segment_size_ = 0;
+	size_t num_threads_ = 0;
+	Matcher* matcher_ = nullptr;
+
+	// synthetic text which brings the parser into the split array
+	// for the last segment, or closes it after the first one
+	std::string enter_array_;
+	std::string leave_array_;
+
+	std::vector<std::thread> threads_;
+	std::mutex mutex_;
+	std::condition_variable job_ready_;
+	std::condition_variable slot_free_;
+	bool stop_ = false;
+	bool finished_ = false;  // consumer has seen last job
+	StickyError error_;
+
+	// jobs are numbered in input order, and stored in a ring by
+	// number; jobs [head_, next_) are being tokenized or waiting
+	// for consumer
+	ArraySplitter splitter_;
+	std::vector<Job> jobs_;
+	size_t head_ = 0;
+	size_t next_ = 0;
+
+private:
+	void run();
+	void tokenize(Job& job, size_t begin, size_t end);
+
+public:
+	ParallelParser() = default;
+	~ParallelParser();
+
+	ParallelParser(const ParallelParser&) = delete;
+	ParallelParser& operator=(const ParallelParser&) = delete;
+
+	// takes over memory mapped input; worker threads are started on
+	// first next() call. Segments are at least segment_size bytes
+	// The array to split is found on the first next() call, following
+	// map keys by matcher, which must stay valid meanwhile
+	bool open(Input& input, size_t num_threads, size_t segment_size, int yajl_flags, int verbose_errors, bool raw_numbers, Matcher& matcher);
+
+	// makes workers pass numbers as is; only possible before the
+	// first next() call
+	void use_raw_numbers();
+
+	// stops worker threads and frees all resources
+	void close();
+
+	bool active() const;
+
+	// waits for next tape and replays it into given callbacks; sets
+	// *eof after the last one, and *input_size to the size of its
+	// segment
+	bool next(const yajl_callbacks* callbacks, void* ctx, bool* eof, size_t* input_size);
+};
+
+#endif
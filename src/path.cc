@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "path.hh"
+
+#include <cassert>
+
+void Path::clear() {
+	entries_.clear();
+	arena_.clear();
+}
+
+bool Path::push_map() {
+	return entries_.push_back(Entry{true, arena_.size(), 0, 0});
+}
+
+bool Path::push_array() {
+	return entries_.push_back(Entry{false, arena_.size(), 0, 0});
+}
+
+void Path::pop() {
+	assert(!entries_.empty());
+	arena_.resize(entries_.back().key_offset);
+	entries_.pop_back();
+}
+
+void Path::set_key(const char* data, size_t len) {
+	assert(!entries_.empty() && entries_.back().is_map);
+	Entry& top = entries_.back();
+	arena_.resize(top.key_offset);
+	arena_.append(data, len);
+	top.key_length = len;
+}
+
+void Path::set_index(size_t index) {
+	assert(!entries_.empty() && !entries_.back().is_map);
+	entries_.back().index = index;
+}
+
+void Path::increment_index() {
+	if (!entries_.empty() && !entries_.back().is_map) {
+		entries_.back().index++;
+	}
+}
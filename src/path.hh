@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef JSONSLICER_PATH_HH
+#define JSONSLICER_PATH_HH
+
+#include "small_vector.hh"
+
+#include <string>
+
+// Current position in JSON document, stored natively as a stack of
+// container entries. Map keys are kept in a contiguous byte arena, with
+// key of the innermost map always at its end, so replacing the key is
+// just an arena truncation followed by append.
+class Path {
+private:
+	struct Entry {
+		bool is_map;
+		size_t key_offset;
+		size_t key_length;
+		size_t index;
+	};
+
+private:
+	SmallVector<Entry, 16> entries_;
+	std::string arena_;
+
+public:
+	void clear();
+
+	size_t size() const {
+		return entries_.size();
+	}
+
+	bool empty() const {
+		return entries_.empty();
+	}
+
+	bool push_map();
+	bool push_array();
+	void pop();
+
+	void set_key(const char* data, size_t len);
+	void increment_index();
+	void set_index(size_t index);
+
+	bool is_map(size_t pos) const {
+		return entries_[pos].is_map;
+	}
+
+	bool is_top_map() const {
+		return !entries_.empty() && entries_.back().is_map;
+	}
+
+	const char* key_data(size_t pos) const {
+		return arena_.data() + entries_[pos].key_offset;
+	}
+
+	size_t key_size(size_t pos) const {
+		return entries_[pos].key_length;
+	}
+
+	size_t index(size_t pos) const {
+		return entries_[pos].index;
+	}
+
+};
+
+#endif
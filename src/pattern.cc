@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "pattern.hh"
+
+#include "encoding.hh"
+
+#include <Python.h>
+
+bool Pattern::compile(PyObject* sequence, PyObjPtr encoding, PyObjPtr errors, const char* what) {
+	std::string message = std::string(what) + " must be iterable";
+	PyObjPtr items = PyObjPtr::Take(PySequence_Fast(sequence, message.c_str()));
+	if (!items) {
+		return false;
+	}
+
+	std::vector<PatternElement> elements;
+	elements.reserve(PySequence_Fast_GET_SIZE(items.get()));
+
+	for (Py_ssize_t i = 0; i < PySequence_Fast_GET_SIZE(items.get()); i++) {
+		PyObjPtr item = encode(PyObjPtr::Borrow(PySequence_Fast_GET_ITEM(items.get(), i)), encoding, errors);
+		if (!item) {
+			return false;
+		}
+
+		PatternElement element;
+		element.type = PatternElement::Type::NEVER;
+		element.index = 0;
+
+		if (item.get() == Py_None) {
+			element.type = PatternElement::Type::WILDCARD;
+		} else if (item.get() == Py_Ellipsis) {
+			element.type = PatternElement::Type::ANY_DEPTH;
+		} else if (PyBytes_Check(item.get())) {
+			element.type = PatternElement::Type::KEY;
+			element.key.assign(PyBytes_AS_STRING(item.get()), PyBytes_GET_SIZE(item.get()));
+		} else if (PyLong_Check(item.get())) {
+			// negative or too large indexes are not errors, they just never match
+			int overflow;
+			long long value = PyLong_AsLongLongAndOverflow(item.get(), &overflow);
+			if (value == -1 && PyErr_Occurred()) {
+				return false;
+			}
+			if (overflow == 0 && value >= 0) {
+				element.type = PatternElement::Type::INDEX;
+				element.index = value;
+			}
+		}
+
+		elements.push_back(element);
+	}
+
+	elements_.swap(elements);
+	return true;
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef JSONSLICER_PATTERN_HH
+#define JSONSLICER_PATTERN_HH
+
+#include "pyobjptr.hh"
+
+#include <Python.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+struct PatternElement {
+	enum class Type {
+		WILDCARD,
+		KEY,
+		INDEX,
+		NEVER,  // element which cannot match anything, such as negative index
+		ANY_DEPTH,  // any number (including zero) of any elements
+	};
+
+	Type type;
+	std::string key;
+	size_t index;
+
+	bool matches_key(const char* data, size_t len) const {
+		return type == Type::WILDCARD || (type == Type::KEY && key.size() == len && memcmp(key.data(), data, len) == 0);
+	}
+
+	bool matches_index(size_t value) const {
+		return type == Type::WILDCARD || (type == Type::INDEX && index == value);
+	}
+};
+
+class Pattern {
+private:
+	std::vector<PatternElement> elements_;
+
+public:
+	// converts python sequence of str/bytes/int/None into native
+	// form, with map keys encoded into given encoding
+	bool compile(PyObject* sequence, PyObjPtr encoding, PyObjPtr errors, const char* what = "path_prefix");
+
+	size_t size() const {
+		return elements_.size();
+	}
+
+	const PatternElement& operator[](size_t pos) const {
+		return elements_[pos];
+	}
+
+	bool has_any_depth() const {
+		for (const auto& element: elements_) {
+			if (element.type == PatternElement::Type::ANY_DEPTH) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void swap(Pattern& other) {
+		elements_.swap(other.elements_);
+	}
+};
+
+#endif
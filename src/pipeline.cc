@@ -0,0 +1,399 @@
+/*
+ * Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "pipeline.hh"
+
+#include "jsonslicer.hh"
+
+#include <Python.h>
+#include <yajl/yajl_parse.h>
+
+#include <cassert>
+#include <cerrno>
+
+const unsigned char* Pipeline::Batch::string_data(const Event& event) const {
+	return reinterpret_cast<const unsigned char*>(arena.data()) + event.string.offset;
+}
+
+void Pipeline::Batch::clear() {
+	events.clear();
+	arena.clear();
+	input_size = 0;
+	eof = false;
+	read_errno = 0;
+	parser_error.clear();
+}
+
+bool Pipeline::Batch::replay(const yajl_callbacks* callbacks, void* ctx, size_t first, size_t last) const {
+	for (size_t i = first; i < last; i++) {
+		const Event& event = events[i];
+		bool success = true;
+		switch (event.type) {
+		case EventType::NUL: success = callbacks->yajl_null(ctx); break;
+		case EventType::BOOLEAN: success = callbacks->yajl_boolean(ctx, event.boolean); break;
+		case EventType::INTEGER: success = callbacks->yajl_integer(ctx, event.integer); break;
+		case EventType::DOUBLE: success = callbacks->yajl_double(ctx, event.real); break;
+		case EventType::NUMBER: success = callbacks->yajl_number(ctx, reinterpret_cast<const char*>(string_data(event)), event.string.length); break;
+		case EventType::STRING: success = callbacks->yajl_string(ctx, string_data(event), event.string.length); break;
+		case EventType::START_MAP: success = callbacks->yajl_start_map(ctx); break;
+		case EventType::MAP_KEY: success = callbacks->yajl_map_key(ctx, string_data(event), event.string.length); break;
+		case EventType::END_MAP: success = callbacks->yajl_end_map(ctx); break;
+		case EventType::START_ARRAY: success = callbacks->yajl_start_array(ctx); break;
+		case EventType::END_ARRAY: success = callbacks->yajl_end_array(ctx); break;
+		}
+
+		if (!success) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool Pipeline::Batch::check_error() const {
+	if (read_errno != 0) {
+		errno = read_errno;
+		PyErr_SetFromErrno(PyExc_OSError);
+		return false;
+	}
+
+	if (!parser_error.empty()) {
+		PyErr_Format(PyExc_RuntimeError, "YAJL error: %s", parser_error.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+bool Pipeline::StickyError::save() {
+	PyObject* type;
+	PyObject* value;
+	PyObject* traceback;
+	PyErr_Fetch(&type, &value, &traceback);
+	type_ = PyObjPtr::Take(type);
+	value_ = PyObjPtr::Take(value);
+	traceback_ = PyObjPtr::Take(traceback);
+	return raise();
+}
+
+bool Pipeline::StickyError::raise() const {
+	PyErr_Restore(
+		type_ ? type_.getref() : nullptr,
+		value_ ? value_.getref() : nullptr,
+		traceback_ ? traceback_.getref() : nullptr
+	);
+	return false;
+}
+
+void Pipeline::StickyError::clear() {
+	type_ = {};
+	value_ = {};
+	traceback_ = {};
+}
+
+Pipeline::~Pipeline() {
+	close();
+}
+
+bool Pipeline::open(Input& input, int yajl_flags, int verbose_errors, bool raw_numbers) {
+	close();
+
+	yajl_handle yajl = JsonSlicer_alloc_yajl(raw_numbers ? &Recorder::number_handlers : &Recorder::handlers, &recorder_, yajl_flags);
+	if (yajl == nullptr) {
+		return false;
+	}
+
+	yajl_ = yajl;
+	yajl_flags_ = yajl_flags;
+	verbose_errors_ = verbose_errors;
+	input_.swap(input);
+
+	stop_ = false;
+	finished_ = false;
+	error_.clear();
+	head_ = 0;
+	filled_ = 0;
+
+	return true;
+}
+
+void Pipeline::close() {
+	if (thread_.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stop_ = true;
+		}
+		slot_free_.notify_one();
+
+		// the worker may be blocked in read(2), which cannot be
+		// interrupted, so this waits for it to complete
+		thread_.join();
+	}
+
+	if (yajl_ != nullptr) {
+		yajl_free(yajl_);
+		yajl_ = nullptr;
+	}
+
+	Input empty;
+	input_.swap(empty);
+
+	for (auto& batch: batches_) {
+		batch.clear();
+	}
+}
+
+bool Pipeline::use_raw_numbers() {
+	assert(!thread_.joinable());
+
+	yajl_handle yajl = JsonSlicer_alloc_yajl(&Recorder::number_handlers, &recorder_, yajl_flags_);
+	if (yajl == nullptr) {
+		return false;
+	}
+
+	std::swap(yajl_, yajl);
+	yajl_free(yajl);
+	return true;
+}
+
+bool Pipeline::active() const {
+	return yajl_ != nullptr;
+}
+
+void Pipeline::run() {
+	size_t tail = 0;
+	bool eof = false;
+
+	while (!eof) {
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			slot_free_.wait(lock, [this]{ return stop_ || filled_ < NUM_BATCHES; });
+			if (stop_) {
+				return;
+			}
+			tail = (head_ + filled_) % NUM_BATCHES;
+		}
+
+		Batch& batch = batches_[tail];
+		tokenize(batch);
+		eof = batch.eof;
+
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			filled_++;
+		}
+		batch_ready_.notify_one();
+	}
+}
+
+void Pipeline::tokenize(Batch& batch) {
+	batch.clear();
+	recorder_.batch = &batch;
+
+	const unsigned char* data;
+	size_t len;
+	bool success;
+	do {
+		success = input_.read_native(&data, &len);
+	} while (!success && errno == EINTR);
+
+	if (!success) {
+		batch.read_errno = errno;
+		batch.eof = true;
+		return;
+	}
+
+	batch.input_size = len;
+
+	yajl_status status;
+	if (len == 0) {
+		batch.eof = true;
+		status = yajl_complete_parse(yajl_);
+	} else {
+		status = yajl_parse(yajl_, data, len);
+	}
+
+	if (status != yajl_status_ok) {
+		// tape handlers never cancel parsing, so this is an error
+		unsigned char* error = yajl_get_error(yajl_, verbose_errors_, data, len);
+		batch.parser_error = reinterpret_cast<const char*>(error);
+		yajl_free_error(yajl_, error);
+		batch.eof = true;
+	}
+}
+
+bool Pipeline::next(const yajl_callbacks* callbacks, void* ctx, bool* eof, size_t* input_size) {
+	*input_size = 0;
+	if (error_.active()) {
+		return error_.raise();
+	}
+	if (finished_) {
+		*eof = true;
+		return true;
+	}
+
+	if (!thread_.joinable()) {
+		thread_ = std::thread(&Pipeline::run, this);
+	}
+
+	Batch* batch;
+	Py_BEGIN_ALLOW_THREADS
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		batch_ready_.wait(lock, [this]{ return filled_ > 0; });
+		batch = &batches_[head_];
+	}
+	Py_END_ALLOW_THREADS
+
+	*input_size = batch->input_size;
+	bool success = batch->replay(callbacks, ctx, 0, batch->events.size()) && batch->check_error();
+
+	if (batch->eof) {
+		// worker is done, no need to hand the batch back
+		finished_ = true;
+		*eof = true;
+	} else {
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			head_ = (head_ + 1) % NUM_BATCHES;
+			filled_--;
+		}
+		slot_free_.notify_one();
+	}
+
+	if (!success) {
+		// events after the failed one are never replayed
+		return error_.save();
+	}
+
+	return true;
+}
+
+void Pipeline::Recorder::push(const Event& event) {
+	batch->events.push_back(event);
+}
+
+void Pipeline::Recorder::push_string(EventType type, const unsigned char* str, size_t len) {
+	Event event;
+	event.type = type;
+	event.string.offset = batch->arena.size();
+	event.string.length = len;
+	batch->arena.append(reinterpret_cast<const char*>(str), len);
+	batch->events.push_back(event);
+}
+
+static void push_event(void* ctx, Pipeline::EventType type) {
+	Pipeline::Event event;
+	event.type = type;
+	static_cast<Pipeline::Recorder*>(ctx)->push(event);
+}
+
+static int tape_null(void* ctx) {
+	push_event(ctx, Pipeline::EventType::NUL);
+	return 1;
+}
+
+static int tape_boolean(void* ctx, int val) {
+	Pipeline::Event event;
+	event.type = Pipeline::EventType::BOOLEAN;
+	event.boolean = val;
+	static_cast<Pipeline::Recorder*>(ctx)->push(event);
+	return 1;
+}
+
+static int tape_integer(void* ctx, long long val) {
+	Pipeline::Event event;
+	event.type = Pipeline::EventType::INTEGER;
+	event.integer = val;
+	static_cast<Pipeline::Recorder*>(ctx)->push(event);
+	return 1;
+}
+
+static int tape_double(void* ctx, double val) {
+	Pipeline::Event event;
+	event.type = Pipeline::EventType::DOUBLE;
+	event.real = val;
+	static_cast<Pipeline::Recorder*>(ctx)->push(event);
+	return 1;
+}
+
+static int tape_number(void* ctx, const char* str, size_t len) {
+	static_cast<Pipeline::Recorder*>(ctx)->push_string(Pipeline::EventType::NUMBER, reinterpret_cast<const unsigned char*>(str), len);
+	return 1;
+}
+
+static int tape_string(void* ctx, const unsigned char* str, size_t len) {
+	static_cast<Pipeline::Recorder*>(ctx)->push_string(Pipeline::EventType::STRING, str, len);
+	return 1;
+}
+
+static int tape_start_map(void* ctx) {
+	push_event(ctx, Pipeline::EventType::START_MAP);
+	return 1;
+}
+
+static int tape_map_key(void* ctx, const unsigned char* str, size_t len) {
+	static_cast<Pipeline::Recorder*>(ctx)->push_string(Pipeline::EventType::MAP_KEY, str, len);
+	return 1;
+}
+
+static int tape_end_map(void* ctx) {
+	push_event(ctx, Pipeline::EventType::END_MAP);
+	return 1;
+}
+
+static int tape_start_array(void* ctx) {
+	push_event(ctx, Pipeline::EventType::START_ARRAY);
+	return 1;
+}
+
+static int tape_end_array(void* ctx) {
+	push_event(ctx, Pipeline::EventType::END_ARRAY);
+	return 1;
+}
+
+const yajl_callbacks Pipeline::Recorder::handlers = {
+	tape_null,
+	tape_boolean,
+	tape_integer,
+	tape_double,
+	nullptr,
+	tape_string,
+	tape_start_map,
+	tape_map_key,
+	tape_end_map,
+	tape_start_array,
+	tape_end_array
+};
+
+const yajl_callbacks Pipeline::Recorder::number_handlers = {
+	tape_null,
+	tape_boolean,
+	nullptr,
+	nullptr,
+	tape_number,
+	tape_string,
+	tape_start_map,
+	tape_map_key,
+	tape_end_map,
+	tape_start_array,
+	tape_end_array
+};
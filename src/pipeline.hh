@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef JSONSLICER_PIPELINE_HH
+#define JSONSLICER_PIPELINE_HH
+
+#include "input.hh"
+#include "pyobjptr.hh"
+
+#include <Python.h>
+#include <yajl/yajl_parse.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Reads and tokenizes native input in a background thread, which
+// does not need the GIL. Parser events are recorded into a tape,
+// which is then replayed into the real handlers by the main thread.
+//
+// The tape is split into batches, one per input chunk, which are
+// passed through a bounded ring, so the worker never gets too far
+// ahead of the consumer.
+class Pipeline {
+public:
+	enum class EventType : unsigned char {
+		NUL,
+		BOOLEAN,
+		INTEGER,
+		DOUBLE,
+		NUMBER,  // as text, in batch arena
+		STRING,
+		START_MAP,
+		MAP_KEY,
+		END_MAP,
+		START_ARRAY,
+		END_ARRAY,
+	};
+
+	struct Event {
+		EventType type;
+		union {
+			int boolean;
+			long long integer;
+			double real;
+			struct {
+				size_t offset;  // in batch arena
+				size_t length;
+			} string;
+		};
+	};
+
+	struct Batch {
+		std::vector<Event> events;
+		std::string arena;  // string and key data
+		size_t input_size = 0;  // bytes of input tokenized
+
+		bool eof = false;
+		int read_errno = 0;
+		std::string parser_error;
+
+		const unsigned char* string_data(const Event& event) const;
+		void clear();
+
+		// replays events [first, last) into given callbacks; returns
+		// false if any of them cancels, and PyErr is set then
+		bool replay(const yajl_callbacks* callbacks, void* ctx, size_t first, size_t last) const;
+
+		// sets PyErr from error recorded by the worker, if any
+		bool check_error() const;
+	};
+
+	// YAJL callbacks which record events into a batch; the context
+	// is a Recorder, so the same parser may fill different batches
+	struct Recorder {
+		Batch* batch = nullptr;
+
+		static const yajl_callbacks handlers;
+		static const yajl_callbacks number_handlers;  // with raw numbers
+
+		void push(const Event& event);
+		void push_string(EventType type, const unsigned char* str, size_t len);
+	};
+
+	// error which stopped replaying, raised again on every later call,
+	// as a failed parser keeps failing in non-pipelined mode
+	class StickyError {
+	private:
+		PyObjPtr type_;
+		PyObjPtr value_;
+		PyObjPtr traceback_;
+
+	public:
+		bool active() const {
+			return type_.valid();
+		}
+
+		// takes current PyErr; returns false
+		bool save();
+
+		// sets PyErr to saved error; returns false
+		bool raise() const;
+
+		void clear();
+	};
+
+private:
+	static constexpr size_t NUM_BATCHES = 4;
+
+	Input input_;
+	Recorder recorder_;
+	yajl_handle yajl_ = nullptr;
+	int yajl_flags_ = 0;
+	int verbose_errors_ = 0;
+
+	std::thread thread_;
+	std::mutex mutex_;
+	std::condition_variable batch_ready_;
+	std::condition_variable slot_free_;
+	bool stop_ = false;
+	bool finished_ = false;  // consumer has seen last batch
+	StickyError error_;
+
+	// batches [head_, head_ + filled_) are owned by consumer, the
+	// rest by worker
+	Batch batches_[NUM_BATCHES];
+	size_t head_ = 0;
+	size_t filled_ = 0;
+
+private:
+	void run();
+	void tokenize(Batch& batch);
+
+public:
+	Pipeline() = default;
+	~Pipeline();
+
+	Pipeline(const Pipeline&) = delete;
+	Pipeline& operator=(const Pipeline&) = delete;
+
+	// takes over native input, and prepares tokenizer; worker
+	// thread is started on first next() call. With raw_numbers,
+	// numbers are passed to yajl_number callback as is
+	bool open(Input& input, int yajl_flags, int verbose_errors, bool raw_numbers = false);
+
+	// replaces tokenizer with one which passes numbers as is; only
+	// possible before the first next() call
+	bool use_raw_numbers();
+
+	// stops worker thread and frees all resources
+	void close();
+
+	bool active() const;
+
+	// waits for next batch of events and replays it into given
+	// callbacks; sets *eof after the last batch, and *input_size to
+	// the size of input chunk the batch was made from
+	bool next(const yajl_callbacks* callbacks, void* ctx, bool* eof, size_t* input_size);
+};
+
+#endif
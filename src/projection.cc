@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "projection.hh"
+
+#include <Python.h>
+
+#include <cstring>
+
+constexpr int Projection::WHOLE;
+constexpr int Projection::SKIP;
+
+int Projection::add_node() {
+	nodes_.emplace_back();
+	return nodes_.size() - 1;
+}
+
+int Projection::key_child(int node, const std::string& key) {
+	for (const auto& child: nodes_[node].keys) {
+		if (child.first == key) {
+			return child.second;
+		}
+	}
+	int child = add_node();
+	nodes_[node].keys.emplace_back(key, child);
+	return child;
+}
+
+int Projection::index_child(int node, size_t index) {
+	for (const auto& child: nodes_[node].indexes) {
+		if (child.first == index) {
+			return child.second;
+		}
+	}
+	int child = add_node();
+	nodes_[node].indexes.emplace_back(index, child);
+	return child;
+}
+
+int Projection::wildcard_child(int node) {
+	if (nodes_[node].wildcard == -1) {
+		int child = add_node();
+		nodes_[node].wildcard = child;
+	}
+	return nodes_[node].wildcard;
+}
+
+void Projection::insert(const Pattern& pattern) {
+	int node = 0;
+	for (size_t i = 0; i < pattern.size(); i++) {
+		switch (pattern[i].type) {
+		case PatternElement::Type::WILDCARD:
+			node = wildcard_child(node);
+			break;
+		case PatternElement::Type::KEY:
+			node = key_child(node, pattern[i].key);
+			break;
+		case PatternElement::Type::INDEX:
+			node = index_child(node, pattern[i].index);
+			break;
+		case PatternElement::Type::NEVER:
+		case PatternElement::Type::ANY_DEPTH:  // rejected at compile time
+			return;
+		}
+	}
+	nodes_[node].terminal = true;
+}
+
+void Projection::merge(int dst, int src) {
+	if (nodes_[src].terminal) {
+		nodes_[dst].terminal = true;
+	}
+
+	// children are copied, as adding nodes invalidates references
+	auto keys = nodes_[src].keys;
+	for (const auto& child: keys) {
+		merge(key_child(dst, child.first), child.second);
+	}
+	auto indexes = nodes_[src].indexes;
+	for (const auto& child: indexes) {
+		merge(index_child(dst, child.first), child.second);
+	}
+	if (nodes_[src].wildcard != -1) {
+		int wildcard = nodes_[src].wildcard;
+		merge(wildcard_child(dst), wildcard);
+	}
+}
+
+void Projection::normalize(int node) {
+	int wildcard = nodes_[node].wildcard;
+	if (wildcard != -1) {
+		auto keys = nodes_[node].keys;
+		for (const auto& child: keys) {
+			merge(child.second, wildcard);
+		}
+		auto indexes = nodes_[node].indexes;
+		for (const auto& child: indexes) {
+			merge(child.second, wildcard);
+		}
+	}
+
+	std::vector<int> children;
+	for (const auto& child: nodes_[node].keys) {
+		children.push_back(child.second);
+	}
+	for (const auto& child: nodes_[node].indexes) {
+		children.push_back(child.second);
+	}
+	if (wildcard != -1) {
+		children.push_back(wildcard);
+	}
+	for (int child: children) {
+		normalize(child);
+	}
+}
+
+bool Projection::compile(PyObject* fields, PyObjPtr encoding, PyObjPtr errors) {
+	if (fields == nullptr || fields == Py_None) {
+		nodes_.clear();
+		return true;
+	}
+
+	PyObjPtr items = PyObjPtr::Take(PySequence_Fast(fields, "fields must be iterable"));
+	if (!items) {
+		return false;
+	}
+
+	Projection result;
+	result.add_node();
+
+	for (Py_ssize_t i = 0; i < PySequence_Fast_GET_SIZE(items.get()); i++) {
+		PyObject* item = PySequence_Fast_GET_ITEM(items.get(), i);
+
+		// single path element is a shortcut for a path of length 1
+		PyObjPtr path;
+		if (item == Py_None || PyUnicode_Check(item) || PyBytes_Check(item) || PyLong_Check(item)) {
+			path = PyObjPtr::Take(PyTuple_Pack(1, item));
+		} else {
+			path = PyObjPtr::Borrow(item);
+		}
+		if (!path) {
+			return false;
+		}
+
+		Pattern pattern;
+		if (!pattern.compile(path.get(), encoding, errors, "fields item")) {
+			return false;
+		}
+		if (pattern.has_any_depth()) {
+			PyErr_SetString(PyExc_ValueError, "Recursive wildcard is not supported in fields");
+			return false;
+		}
+		result.insert(pattern);
+	}
+
+	result.normalize(0);
+
+	swap(result);
+	return true;
+}
+
+int Projection::select(int child) const {
+	if (child == -1) {
+		return SKIP;
+	}
+	if (nodes_[child].terminal) {
+		return WHOLE;
+	}
+	return child;
+}
+
+int Projection::select_key(int node, const char* data, size_t len) const {
+	if (node == WHOLE || node == SKIP) {
+		return node;
+	}
+	for (const auto& child: nodes_[node].keys) {
+		if (child.first.size() == len && std::memcmp(child.first.data(), data, len) == 0) {
+			return select(child.second);
+		}
+	}
+	return select(nodes_[node].wildcard);
+}
+
+int Projection::select_index(int node, size_t index) const {
+	if (node == WHOLE || node == SKIP) {
+		return node;
+	}
+	for (const auto& child: nodes_[node].indexes) {
+		if (child.first == index) {
+			return select(child.second);
+		}
+	}
+	return select(nodes_[node].wildcard);
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef JSONSLICER_PROJECTION_HH
+#define JSONSLICER_PROJECTION_HH
+
+#include "pattern.hh"
+#include "pyobjptr.hh"
+
+#include <Python.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// Set of fields to be constructed in matched objects, compiled into a
+// trie of path elements. Each constructed container is associated with
+// a trie node, which decides which of its values are kept; a value may
+// be kept as a whole (WHOLE), kept with its own node which filters
+// it further, or skipped (SKIP).
+//
+// Wildcard branches are merged into all sibling branches at compile
+// time, so lookup never needs to follow more than one branch.
+class Projection {
+public:
+	static constexpr int WHOLE = -1;
+	static constexpr int SKIP = -2;
+
+	// state of constructed container
+	struct Level {
+		int node;
+		bool is_map;
+		size_t index;  // next array index
+	};
+
+private:
+	struct Node {
+		bool terminal = false;
+		std::vector<std::pair<std::string, int>> keys;
+		std::vector<std::pair<size_t, int>> indexes;
+		int wildcard = -1;
+	};
+
+private:
+	std::vector<Node> nodes_;
+
+private:
+	int add_node();
+	int key_child(int node, const std::string& key);
+	int index_child(int node, size_t index);
+	int wildcard_child(int node);
+
+	void insert(const Pattern& pattern);
+	void merge(int dst, int src);
+	void normalize(int node);
+
+	int select(int child) const;
+
+public:
+	// fields is an iterable of field names or sequences of path
+	// elements (str/bytes/int/None), None means no projection
+	bool compile(PyObject* fields, PyObjPtr encoding, PyObjPtr errors);
+
+	bool active() const {
+		return !nodes_.empty();
+	}
+
+	// node for the matched object
+	int root() const {
+		return nodes_.empty() || nodes_[0].terminal ? WHOLE : 0;
+	}
+
+	// given node of a container, decide what to do with its value;
+	// values of skipped container (which may still be visited) are
+	// skipped as well
+	int select_key(int node, const char* data, size_t len) const;
+	int select_index(int node, size_t index) const;
+
+	void swap(Projection& other) {
+		nodes_.swap(other.nodes_);
+	}
+};
+
+#endif
@@ -21,7 +21,6 @@
  */
 
 #include "jsonslicer.hh"
-#include "pymutindex.hh"
 
 #include <Python.h>
 
@@ -40,8 +39,6 @@ static struct PyModuleDef jsonslicer_module_def = {
 PyMODINIT_FUNC PyInit_jsonslicer(void) {
 	if (PyType_Ready(&JsonSlicerType) < 0)
 		return nullptr;
-	if (PyType_Ready(&PyMutIndex_type) < 0)
-		return nullptr;
 
 	PyObject* m = PyModule_Create(&jsonslicer_module_def);
 	if (m == nullptr)
@@ -52,5 +49,9 @@ PyMODINIT_FUNC PyInit_jsonslicer(void) {
 
 	PyModule_AddStringConstant(m, "__version__", JSONSLICER_VERSION);
 
+	// recursive wildcard path element, an alias for ...
+	Py_INCREF(Py_Ellipsis);
+	PyModule_AddObject(m, "ANY_DEPTH", Py_Ellipsis);
+
 	return m;
 }
@@ -20,21 +20,23 @@
  * THE SOFTWARE.
  */
 
-#ifndef JSONSLICER_PYMUTINDEX_HH
-#define JSONSLICER_PYMUTINDEX_HH
+#include "read_size_tuner.hh"
 
-#include <Python.h>
+constexpr size_t ReadSizeTuner::MIN_SIZE;
+constexpr size_t ReadSizeTuner::MAX_SIZE;
+constexpr size_t ReadSizeTuner::INITIAL_SIZE;
+constexpr size_t ReadSizeTuner::PIPELINED_SIZE;
+constexpr size_t ReadSizeTuner::PARALLEL_SIZE;
+constexpr size_t ReadSizeTuner::GROW_BELOW;
+constexpr size_t ReadSizeTuner::SHRINK_ABOVE;
 
-struct PyMutIndex {
-	PyObject_HEAD
-	size_t value;
-};
-
-bool PyMutIndex_Check(PyObject* object);
-PyObject* PyMutIndex_New();
-void PyMutIndex_Increment(PyObject* self);
-PyObject* PyMutIndex_AsPyLong(PyObject* self);
-
-extern PyTypeObject PyMutIndex_type;
-
-#endif
+bool ReadSizeTuner::update(size_t queued) {
+	if (queued < GROW_BELOW && size_ < MAX_SIZE) {
+		size_ *= 2;
+		return true;
+	} else if (queued > SHRINK_ABOVE && size_ > MIN_SIZE) {
+		size_ /= 2;
+		return true;
+	}
+	return false;
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef JSONSLICER_READ_SIZE_TUNER_HH
+#define JSONSLICER_READ_SIZE_TUNER_HH
+
+#include <cstddef>
+
+// Picks read size for read_size='auto' mode, based on how many
+// complete objects each chunk produces. Chunk is grown geometrically
+// while it yields few objects, so per-read overhead is amortized,
+// and shrunk when too many objects are queued at once, so memory use
+// stays bounded. Thresholds are far apart to avoid oscillation.
+class ReadSizeTuner {
+public:
+	static constexpr size_t MIN_SIZE = 1024;
+	static constexpr size_t MAX_SIZE = 1024 * 1024;
+	static constexpr size_t INITIAL_SIZE = 16 * 1024;
+	static constexpr size_t PIPELINED_SIZE = 64 * 1024;
+	static constexpr size_t PARALLEL_SIZE = 1024 * 1024;
+
+	static constexpr size_t GROW_BELOW = 64;    // objects per chunk
+	static constexpr size_t SHRINK_ABOVE = 1024;
+
+private:
+	size_t size_ = INITIAL_SIZE;
+
+public:
+	size_t size() const {
+		return size_;
+	}
+
+	void reset() {
+		size_ = INITIAL_SIZE;
+	}
+
+	// called after each chunk with the number of objects queued
+	// for output; returns true if read size should be changed
+	bool update(size_t queued);
+};
+
+#endif
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef JSONSLICER_RING_BUFFER_HH
+#define JSONSLICER_RING_BUFFER_HH
+
+#include <cassert>
+#include <cstddef>
+#include <new>
+#include <utility>
+
+// FIFO queue in a contiguous circular buffer, which doubles when
+// full. Capacity is always a power of two, so wrapping is a mask.
+// Growth does not throw, but is reported via push_back() return value.
+template <class T>
+class RingBuffer {
+private:
+	static constexpr size_t MIN_CAPACITY = 16;
+
+	T* data_ = nullptr;
+	size_t capacity_ = 0;
+	size_t head_ = 0;
+	size_t size_ = 0;
+
+private:
+	T* slot(size_t pos) {
+		return &data_[(head_ + pos) & (capacity_ - 1)];
+	}
+
+	bool grow() {
+		size_t new_capacity = MIN_CAPACITY;
+		if (capacity_ != 0) {
+			new_capacity = capacity_ * 2;
+		}
+		T* new_data = static_cast<T*>(::operator new(new_capacity * sizeof(T), std::nothrow));
+		if (new_data == nullptr) {
+			return false;
+		}
+
+		for (size_t i = 0; i < size_; i++) {
+			T* old = slot(i);
+			new(&new_data[i]) T(std::move(*old));
+			old->~T();
+		}
+
+		::operator delete(data_);
+
+		data_ = new_data;
+		capacity_ = new_capacity;
+		head_ = 0;
+		return true;
+	}
+
+public:
+	RingBuffer() = default;
+
+	~RingBuffer() {
+		clear();
+		::operator delete(data_);
+	}
+
+	RingBuffer(const RingBuffer&) = delete;
+	RingBuffer& operator=(const RingBuffer&) = delete;
+
+	size_t size() const {
+		return size_;
+	}
+
+	bool empty() const {
+		return size_ == 0;
+	}
+
+	bool push_back(T value) {
+		if (size_ == capacity_ && !grow()) {
+			return false;
+		}
+		new(slot(size_++)) T(std::move(value));
+		return true;
+	}
+
+	T pop_front() {
+		assert(size_ > 0);
+		T* front = slot(0);
+		T value(std::move(*front));
+		front->~T();
+		head_ = (head_ + 1) & (capacity_ - 1);
+		size_--;
+		return value;
+	}
+
+	// capacity is retained
+	void clear() {
+		while (size_ > 0) {
+			pop_front();
+		}
+		head_ = 0;
+	}
+};
+
+#endif
@@ -26,39 +26,137 @@
 
 #include "output_formatting.hh"
 
-#include "pyobjlist.hh"
-#include "pymutindex.hh"
-
 #include <Python.h>
 
+#include <utility>
+#include <vector>
+
 // helpers
-bool check_pattern(JsonSlicer* self) {
-	return self->path.match(self->pattern, [](const PyObjPtr& path, const PyObjPtr& pattern) {
-		return pattern.get() == Py_None || PyObject_RichCompareBool(path.get(), pattern.get(), Py_EQ);
-	});
+
+// Containers are only pushed into path while they may contain matches,
+// and everything else is skipped, so state of the value is derived
+// from the state of the innermost container alone
+int match_value(JsonSlicer* self) {
+	if (self->path.empty()) {
+		return self->matcher.root();
+	}
+
+	size_t pos = self->path.size() - 1;
+	if (self->path.is_map(pos)) {
+		return self->matcher.select_key(self->match_states.back(), self->path.key_data(pos), self->path.key_size(pos));
+	} else {
+		return self->matcher.select_index(self->match_states.back(), self->path.index(pos));
+	}
 }
 
-void update_path(JsonSlicer* self) {
-	if (!self->path.empty() && PyMutIndex_Check(self->path.back().get())) {
-		PyMutIndex_Increment(self->path.back().get());
+bool accept_match(JsonSlicer* self) {
+	if (self->skip_matches > 0) {
+		self->skip_matches--;
+		return false;
+	}
+	if (self->offset_index.active()) {
+		self->offset_index.add(self->path, self->event_end);
+		return false;
 	}
+	self->match_offset = self->event_end;
+	return true;
+}
+
+void update_path(JsonSlicer* self) {
+	self->path.increment_index();
 }
 
 bool finish_complete_object(JsonSlicer* self, PyObjPtr obj) {
 	// regardless of result, we've finished parsing an object
 	self->state = JsonSlicer::State::SEEKING;
 
-	// construct tuple with prepended path
-	PyObjPtr output = generate_output_object(self, obj);
-	if (!output.valid()) {
-		return false;
+	// drop objects which did not pass the filter
+	if (self->filter.active() && !self->filter.accepted()) {
+		update_path(self);
+		return true;
 	}
 
-	// save in list of complete objects
-	if (!self->complete.push_back(output)) {
-		return false;
+	if (self->aggregator.active()) {
+		self->aggregator.add(self->filter);
+		update_path(self);
+		return true;
+	}
+
+	// value matched by multiple patterns is returned for each of them
+	const std::vector<int>& patterns = self->matcher.patterns(self->match_state);
+	for (size_t i = 0; i < patterns.size(); i++) {
+		// construct tuple with prepended path
+		PyObjPtr output = generate_output_object(self, obj, self->matcher.multiple() ? patterns[i] : -1);
+		if (!output.valid()) {
+			return false;
+		}
+
+		// save in list of complete objects
+		if (!self->complete.push_back(output)) {
+			PyErr_NoMemory();
+			return false;
+		}
+		self->stats.update_peak_complete(self->complete.size());
+
+		// parsing is resumed after the match once all of its objects
+		// are returned, and at the match otherwise
+		if (self->checkpoints) {
+			OffsetIndex::Checkpoint checkpoint;
+			checkpoint.entry = OffsetIndex::make_entry(self->match_offset, self->path);
+			checkpoint.skip = i + 1 == patterns.size() ? 1 : 0;
+			if (!self->complete_checkpoints.push_back(std::move(checkpoint))) {
+				PyErr_NoMemory();
+				return false;
+			}
+		}
 	}
 
 	update_path(self);
 	return true;
 }
+
+bool finish_raw_object(JsonSlicer* self) {
+	if (!self->sink.active()) {
+		return finish_complete_object(self, take_raw_output(self));
+	}
+
+	self->state = JsonSlicer::State::SEEKING;
+
+	// written once, even if matched by multiple patterns
+	if (!self->filter.active() || self->filter.accepted()) {
+		const unsigned char* buf;
+		size_t len;
+		if (!check_gen_status(yajl_gen_get_buf(self->raw_gen, &buf, &len)) || !self->sink.write_line(buf, len)) {
+			return false;
+		}
+		self->stats.objects++;
+	}
+
+	reset_raw_output(self);
+	update_path(self);
+	return true;
+}
+
+bool reject_object(JsonSlicer* self, size_t depth) {
+	self->constructing.clear();
+	self->projection_levels.clear();
+	if (self->output_mode == JsonSlicer::OutputMode::RAW) {
+		reset_raw_output(self);
+	}
+
+	if (depth == 0) {
+		self->state = JsonSlicer::State::SEEKING;
+		update_path(self);
+		return true;
+	}
+
+	self->state = JsonSlicer::State::SKIPPING;
+	self->skip_depth = depth;
+	self->stats.skipped_subtrees++;
+	if (self->fast_skip) {
+		// interrupt parser, the rest is handled by skip scanner
+		self->fast_skip_requested = true;
+		return false;
+	}
+	return true;
+}
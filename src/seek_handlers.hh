@@ -28,7 +28,24 @@
 #include <Python.h>
 
 bool finish_complete_object(JsonSlicer* self, PyObjPtr obj);
-bool check_pattern(JsonSlicer* self);
+
+// same for raw output mode, takes generated JSON text; writes it
+// into the sink when dumping
+bool finish_raw_object(JsonSlicer* self);
+
+// stops constructing object which failed the filter (or does not
+// need to be constructed at all), skipping the rest of its depth
+// containers
+bool reject_object(JsonSlicer* self, size_t depth);
+
+// called for each matched value; returns false if it should not be
+// constructed, which is the case for values skipped after seek(), and
+// for all values while building offset index
+bool accept_match(JsonSlicer* self);
+
+// matcher state of the value at current path
+int match_value(JsonSlicer* self);
+
 void update_path(JsonSlicer* self);
 
 #endif
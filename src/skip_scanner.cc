@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "skip_scanner.hh"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+# define JSONSLICER_SCANNER_X86
+# include <immintrin.h>
+#endif
+
+bool SkipScanner::scan_scalar(const unsigned char* data, size_t len, size_t* pos, bool stop_at_comma) {
+	for (size_t i = 0; i < len; i++) {
+		unsigned char c = data[i];
+		if (in_string_) {
+			if (escaped_) {
+				escaped_ = false;
+			} else if (c == '\\') {
+				escaped_ = true;
+			} else if (c == '"') {
+				in_string_ = false;
+			}
+		} else if (c == '"') {
+			in_string_ = true;
+		} else if (c == '{' || c == '[') {
+			depth_++;
+		} else if (c == '}' || c == ']') {
+			if (--depth_ == 0) {
+				*pos = i + 1;
+				return true;
+			}
+		} else if (c == ',' && stop_at_comma && depth_ == 1) {
+			*pos = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool SkipScanner::scan_to_comma(const unsigned char* data, size_t len, size_t* pos) {
+	return scan_scalar(data, len, pos, true);
+}
+
+// Vectorized kernels process input in blocks, and only fall back to
+// scalar code for blocks which contain backslashes, or blocks where
+// the container may end. Quotes are handled with bit tricks: prefix
+// XOR of quote positions marks characters inside strings, and brackets
+// there are ignored. Note that '{' and '[' (as well as '}' and ']')
+// only differ in 0x20 bit, so each pair is checked with a single
+// comparison.
+struct SkipScannerKernels {
+	static bool scan_scalar(SkipScanner& scanner, const unsigned char* data, size_t len, size_t* pos) {
+		return scanner.scan_scalar(data, len, pos);
+	}
+
+	static unsigned prefix_xor(unsigned mask) {
+		mask ^= mask << 1;
+		mask ^= mask << 2;
+		mask ^= mask << 4;
+		mask ^= mask << 8;
+		mask ^= mask << 16;
+		return mask;
+	}
+
+	static bool process_block(SkipScanner& scanner, unsigned quotes, unsigned backslashes, unsigned opens, unsigned closes, const unsigned char* data, size_t len, size_t* pos) {
+		if (backslashes == 0 && !scanner.escaped_) {
+			// opening quotes and string contents
+			unsigned in_string = prefix_xor(quotes);
+			if (scanner.in_string_) {
+				in_string = ~in_string;
+			}
+			opens &= ~in_string;
+			closes &= ~in_string;
+
+			size_t nopens = __builtin_popcount(opens);
+			size_t ncloses = __builtin_popcount(closes);
+			if (ncloses < scanner.depth_) {
+				scanner.depth_ += nopens;
+				scanner.depth_ -= ncloses;
+				scanner.in_string_ ^= __builtin_popcount(quotes) & 1;
+				return false;
+			}
+		}
+		return scanner.scan_scalar(data, len, pos);
+	}
+
+#ifdef JSONSLICER_SCANNER_X86
+# ifdef __SSE2__
+	static bool scan_sse2(SkipScanner& scanner, const unsigned char* data, size_t len, size_t* pos) {
+		const __m128i quote = _mm_set1_epi8('"');
+		const __m128i backslash = _mm_set1_epi8('\\');
+		const __m128i bit5 = _mm_set1_epi8(0x20);
+		const __m128i open = _mm_set1_epi8('{');
+		const __m128i close = _mm_set1_epi8('}');
+
+		size_t offset = 0;
+		for (; offset + 16 <= len; offset += 16) {
+			__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + offset));
+			__m128i folded = _mm_or_si128(block, bit5);
+
+			unsigned quotes = _mm_movemask_epi8(_mm_cmpeq_epi8(block, quote));
+			unsigned backslashes = _mm_movemask_epi8(_mm_cmpeq_epi8(block, backslash));
+			unsigned opens = _mm_movemask_epi8(_mm_cmpeq_epi8(folded, open));
+			unsigned closes = _mm_movemask_epi8(_mm_cmpeq_epi8(folded, close));
+
+			if (process_block(scanner, quotes, backslashes, opens, closes, data + offset, 16, pos)) {
+				*pos += offset;
+				return true;
+			}
+		}
+
+		if (scanner.scan_scalar(data + offset, len - offset, pos)) {
+			*pos += offset;
+			return true;
+		}
+		return false;
+	}
+# endif
+
+	__attribute__((target("avx2")))
+	static bool scan_avx2(SkipScanner& scanner, const unsigned char* data, size_t len, size_t* pos) {
+		const __m256i quote = _mm256_set1_epi8('"');
+		const __m256i backslash = _mm256_set1_epi8('\\');
+		const __m256i bit5 = _mm256_set1_epi8(0x20);
+		const __m256i open = _mm256_set1_epi8('{');
+		const __m256i close = _mm256_set1_epi8('}');
+
+		size_t offset = 0;
+		for (; offset + 32 <= len; offset += 32) {
+			__m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + offset));
+			__m256i folded = _mm256_or_si256(block, bit5);
+
+			unsigned quotes = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, quote));
+			unsigned backslashes = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, backslash));
+			unsigned opens = _mm256_movemask_epi8(_mm256_cmpeq_epi8(folded, open));
+			unsigned closes = _mm256_movemask_epi8(_mm256_cmpeq_epi8(folded, close));
+
+			if (process_block(scanner, quotes, backslashes, opens, closes, data + offset, 32, pos)) {
+				*pos += offset;
+				return true;
+			}
+		}
+
+		if (scanner.scan_scalar(data + offset, len - offset, pos)) {
+			*pos += offset;
+			return true;
+		}
+		return false;
+	}
+#endif
+
+	typedef bool (*Kernel)(SkipScanner&, const unsigned char*, size_t, size_t*);
+
+	static Kernel select() {
+#ifdef JSONSLICER_SCANNER_X86
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2")) {
+			return scan_avx2;
+		}
+# ifdef __SSE2__
+		return scan_sse2;
+# endif
+#endif
+		return scan_scalar;
+	}
+};
+
+bool SkipScanner::scan(const unsigned char* data, size_t len, size_t* pos) {
+	static const SkipScannerKernels::Kernel kernel = SkipScannerKernels::select();
+	return kernel(*this, data, len, pos);
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef JSONSLICER_SKIP_SCANNER_HH
+#define JSONSLICER_SKIP_SCANNER_HH
+
+#include <cstddef>
+
+// Structural scanner which finds the end of JSON container without
+// tokenizing its contents, only tracking strings, escapes and brackets.
+// The data being skipped is not validated.
+class SkipScanner {
+	friend struct SkipScannerKernels;
+
+private:
+	size_t depth_ = 0;
+	bool in_string_ = false;
+	bool escaped_ = false;
+
+private:
+	bool scan_scalar(const unsigned char* data, size_t len, size_t* pos, bool stop_at_comma = false);
+
+public:
+	// start scanning right after container opening bracket, or
+	// inside given number of nested containers
+	void start(size_t depth = 1) {
+		depth_ = depth;
+		in_string_ = false;
+		escaped_ = false;
+	}
+
+	void reset() {
+		depth_ = 0;
+	}
+
+	bool active() const {
+		return depth_ != 0;
+	}
+
+	// If the end of container is found in the given chunk, returns true
+	// and sets pos to the offset right after its closing bracket.
+	// Otherwise whole chunk is consumed, and scanning may be continued
+	// with the next one.
+	bool scan(const unsigned char* data, size_t len, size_t* pos);
+
+	// Same, but also stops at comma directly inside the outermost
+	// container, setting pos to its offset. Not vectorized, meant
+	// for short distances.
+	bool scan_to_comma(const unsigned char* data, size_t len, size_t* pos);
+};
+
+#endif
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef JSONSLICER_SMALL_VECTOR_HH
+#define JSONSLICER_SMALL_VECTOR_HH
+
+#include <cassert>
+#include <cstddef>
+#include <new>
+#include <utility>
+
+// Vector which keeps up to N elements inline, and only goes to heap
+// for deeper stacks. Growth does not throw, but is reported via
+// push_back() return value.
+template <class T, size_t N>
+class SmallVector {
+private:
+	T* data_;
+	size_t size_ = 0;
+	size_t capacity_ = N;
+
+	alignas(T) unsigned char inline_[N * sizeof(T)];
+
+private:
+	T* inline_data() {
+		return reinterpret_cast<T*>(inline_);
+	}
+
+	bool grow() {
+		size_t new_capacity = capacity_ * 2;
+		T* new_data = static_cast<T*>(::operator new(new_capacity * sizeof(T), std::nothrow));
+		if (new_data == nullptr) {
+			return false;
+		}
+
+		for (size_t i = 0; i < size_; i++) {
+			new(&new_data[i]) T(std::move(data_[i]));
+			data_[i].~T();
+		}
+
+		if (data_ != inline_data()) {
+			::operator delete(data_);
+		}
+
+		data_ = new_data;
+		capacity_ = new_capacity;
+		return true;
+	}
+
+public:
+	SmallVector(): data_(inline_data()) {
+	}
+
+	~SmallVector() {
+		clear();
+		if (data_ != inline_data()) {
+			::operator delete(data_);
+		}
+	}
+
+	SmallVector(const SmallVector&) = delete;
+	SmallVector& operator=(const SmallVector&) = delete;
+
+	size_t size() const {
+		return size_;
+	}
+
+	bool empty() const {
+		return size_ == 0;
+	}
+
+	T& operator[](size_t pos) {
+		assert(pos < size_);
+		return data_[pos];
+	}
+
+	const T& operator[](size_t pos) const {
+		assert(pos < size_);
+		return data_[pos];
+	}
+
+	T& back() {
+		assert(size_ > 0);
+		return data_[size_ - 1];
+	}
+
+	const T& back() const {
+		assert(size_ > 0);
+		return data_[size_ - 1];
+	}
+
+	bool push_back(T value) {
+		if (size_ == capacity_ && !grow()) {
+			return false;
+		}
+		new(&data_[size_++]) T(std::move(value));
+		return true;
+	}
+
+	T pop_back() {
+		assert(size_ > 0);
+		T value(std::move(data_[--size_]));
+		data_[size_].~T();
+		return value;
+	}
+
+	// capacity is retained
+	void clear() {
+		while (size_ > 0) {
+			data_[--size_].~T();
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "stats.hh"
+
+#include "pyobjptr.hh"
+
+#include <Python.h>
+
+PyObject* Stats::to_dict(bool timing) const {
+	PyObjPtr tokens_dict = PyObjPtr::Take(Py_BuildValue(
+		"{s:K,s:K,s:K,s:K,s:K,s:K,s:K,s:K,s:K}",
+		"null", (unsigned long long)tokens[NUL],
+		"boolean", (unsigned long long)tokens[BOOLEAN],
+		"number", (unsigned long long)tokens[NUMBER],
+		"string", (unsigned long long)tokens[STRING],
+		"map_key", (unsigned long long)tokens[MAP_KEY],
+		"start_map", (unsigned long long)tokens[START_MAP],
+		"end_map", (unsigned long long)tokens[END_MAP],
+		"start_array", (unsigned long long)tokens[START_ARRAY],
+		"end_array", (unsigned long long)tokens[END_ARRAY]
+	));
+	if (!tokens_dict) {
+		return nullptr;
+	}
+
+	PyObjPtr result = PyObjPtr::Take(Py_BuildValue(
+		"{s:K,s:K,s:O,s:K,s:K,s:n,s:n}",
+		"bytes_read", (unsigned long long)bytes_read,
+		"chunks_read", (unsigned long long)chunks_read,
+		"tokens", tokens_dict.get(),
+		"objects", (unsigned long long)objects,
+		"skipped_subtrees", (unsigned long long)skipped_subtrees,
+		"peak_complete", (Py_ssize_t)peak_complete,
+		"peak_depth", (Py_ssize_t)peak_depth
+	));
+	if (!result) {
+		return nullptr;
+	}
+
+	if (timing) {
+		const struct {
+			const char* name;
+			uint64_t value;
+		} times[] = {
+			{"read_ns", read_ns},
+			{"parse_ns", parse_ns},
+			{"handlers_ns", handlers_ns},
+		};
+
+		for (const auto& time: times) {
+			PyObjPtr value = PyObjPtr::Take(PyLong_FromUnsignedLongLong(time.value));
+			if (!value || PyDict_SetItemString(result.get(), time.name, value.get()) == -1) {
+				return nullptr;
+			}
+		}
+	}
+
+	return result.release();
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef JSONSLICER_STATS_HH
+#define JSONSLICER_STATS_HH
+
+#include <Python.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Runtime counters of a parser, exposed as stats attribute. Counting
+// is always on, while times (in nanoseconds) are only measured with
+// the timing argument, as taking the clock around every handler call
+// is not free.
+class Stats {
+public:
+	enum Token {
+		NUL,
+		BOOLEAN,
+		NUMBER,
+		STRING,
+		MAP_KEY,
+		START_MAP,
+		END_MAP,
+		START_ARRAY,
+		END_ARRAY,
+		NUM_TOKENS
+	};
+
+	uint64_t bytes_read = 0;
+	uint64_t chunks_read = 0;
+	uint64_t tokens[NUM_TOKENS] = {};
+	uint64_t objects = 0;  // returned to caller or written out
+	uint64_t skipped_subtrees = 0;
+	size_t peak_complete = 0;
+	size_t peak_depth = 0;
+
+	uint64_t read_ns = 0;
+	uint64_t parse_ns = 0;  // excluding handlers
+	uint64_t handlers_ns = 0;
+
+public:
+	static uint64_t now() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	void add_chunk(size_t len) {
+		bytes_read += len;
+		chunks_read++;
+	}
+
+	void update_peak_complete(size_t size) {
+		if (size > peak_complete) {
+			peak_complete = size;
+		}
+	}
+
+	void update_peak_depth(size_t depth) {
+		if (depth > peak_depth) {
+			peak_depth = depth;
+		}
+	}
+
+	PyObject* to_dict(bool timing) const;
+};
+
+#endif
@@ -0,0 +1,164 @@
+# Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+
+
+import io
+import os
+import tempfile
+import unittest
+
+from jsonslicer import JsonSlicer
+
+
+DATA = b'''[
+    {"id": 1, "status": "ok", "amount": 10, "meta": {"size": 1.5}},
+    {"id": 2, "status": "failed", "amount": 2.5, "meta": {"size": 3}},
+    {"id": 3, "status": "ok", "amount": "n/a"},
+    {"id": 4, "status": "ok", "amount": 7, "meta": {"size": -1}},
+    {"id": 5, "amount": 1}
+]'''
+
+
+def aggregate(data, path, slicer_kwargs=None, **kwargs):
+    return JsonSlicer(io.BytesIO(data), path, **(slicer_kwargs or {})).aggregate(**kwargs)
+
+
+class TestJsonSlicerAggregate(unittest.TestCase):
+    def test_count(self):
+        self.assertEqual(aggregate(DATA, (None,)), {'count': 5})
+        self.assertEqual(aggregate(DATA, (None, 'status')), {'count': 4})
+        self.assertEqual(aggregate(DATA, ('missing',)), {'count': 0})
+
+    def test_sum(self):
+        self.assertEqual(aggregate(DATA, (None,), sum='id'), {'count': 5, 'sum': 15})
+        self.assertEqual(aggregate(DATA, (None,), sum='amount', count=False), {'sum': 20.5})
+        self.assertEqual(aggregate(DATA, (None,), sum='missing'), {'count': 5, 'sum': 0})
+
+    def test_sum_overflow(self):
+        data = b'[9223372036854775807, 1]'
+        self.assertEqual(aggregate(data, (None,), sum=(), count=False), {'sum': 9223372036854775808.0})
+
+    def test_min_max(self):
+        self.assertEqual(
+            aggregate(DATA, (None,), min='amount', max=('meta', 'size'), count=False),
+            {'min': 1, 'max': 3}
+        )
+        self.assertEqual(
+            aggregate(DATA, (None,), min=('meta', 'size'), max='amount', count=False),
+            {'min': -1, 'max': 10}
+        )
+        self.assertEqual(aggregate(DATA, (None,), min='status', max='missing', count=False), {'min': None, 'max': None})
+
+    def test_group_by(self):
+        self.assertEqual(
+            aggregate(DATA, (None,), group_by='status', sum='amount'),
+            {
+                'ok': {'count': 3, 'sum': 17},
+                'failed': {'count': 1, 'sum': 2.5},
+                None: {'count': 1, 'sum': 1},
+            }
+        )
+        # order of first appearance
+        self.assertEqual(list(aggregate(DATA, (None,), group_by='status')), ['ok', 'failed', None])
+
+    def test_group_by_types(self):
+        data = b'[{"k": 1}, {"k": 1.0}, {"k": null}, {"k": [1]}, {"k": 2.5}, {"k": "1"}]'
+        self.assertEqual(
+            list(aggregate(data, (None,), group_by='k').items()),
+            [(1, {'count': 2}), (None, {'count': 2}), (2.5, {'count': 1}), ('1', {'count': 1})]
+        )
+
+    def test_group_by_booleans(self):
+        # booleans are equal to integers as dict keys, so they share groups
+        data = b'[{"k": true, "v": 2}, {"k": 1, "v": 3}, {"k": 1.0, "v": 4}, {"k": false, "v": 5}, {"k": 0, "v": 6}, {"k": 2, "v": 7}]'
+        result = aggregate(data, (None,), group_by='k', sum='v')
+        self.assertEqual(
+            list(result.items()),
+            [(1, {'count': 3, 'sum': 9}), (0, {'count': 2, 'sum': 11}), (2, {'count': 1, 'sum': 7})]
+        )
+
+    def test_binary(self):
+        self.assertEqual(
+            aggregate(DATA, (None,), {'binary': True}, group_by='status'),
+            {b'ok': {'count': 3}, b'failed': {'count': 1}, None: {'count': 1}}
+        )
+
+    def test_scalars(self):
+        self.assertEqual(
+            aggregate(DATA, (None, 'amount'), sum=(), min=(), max=()),
+            {'count': 5, 'sum': 20.5, 'min': 1, 'max': 10}
+        )
+
+    def test_where(self):
+        self.assertEqual(
+            aggregate(DATA, (None,), {'where': [('id', '>', 1)]}, group_by='status', sum='id'),
+            {'failed': {'count': 1, 'sum': 2}, 'ok': {'count': 2, 'sum': 7}, None: {'count': 1, 'sum': 5}}
+        )
+
+    def test_count_where(self):
+        for fast_skip in (True, False):
+            self.assertEqual(aggregate(DATA, (None,), {'where': [('status', '==', 'ok')], 'fast_skip': fast_skip}), {'count': 3})
+            self.assertEqual(aggregate(DATA, (None,), {'where': [(('meta', 'size'), '>', 0)], 'fast_skip': fast_skip}), {'count': 2})
+
+    def test_nested_patterns(self):
+        self.assertEqual(
+            aggregate(DATA, [(None, 'meta'), (None, 'id')], sum='size'),
+            {'count': 8, 'sum': 3.5}
+        )
+
+    def test_fast_skip(self):
+        data = b'[' + b','.join(b'{"v": %d, "pad": [[1], {"x": "y"}], "g": "%s"}' % (i, b'ab'[i % 2:i % 2 + 1]) for i in range(100)) + b']'
+        for fast_skip in (True, False):
+            self.assertEqual(
+                aggregate(data, (None,), {'fast_skip': fast_skip, 'read_size': 7}, group_by='g', sum='v', max='v'),
+                {'a': {'count': 50, 'sum': 2450, 'max': 98}, 'b': {'count': 50, 'sum': 2500, 'max': 99}}
+            )
+
+    def test_raw_pipelined(self):
+        with tempfile.NamedTemporaryFile(delete=False) as f:
+            f.write(DATA)
+        try:
+            for kwargs in ({'pipelined': True}, {'output': 'raw'}, {'output': 'raw', 'pipelined': True}):
+                self.assertEqual(JsonSlicer(f.name, (None,), **kwargs).aggregate(sum='amount'), {'count': 5, 'sum': 20.5})
+        finally:
+            os.unlink(f.name)
+
+    def test_after_iteration(self):
+        slicer = JsonSlicer(io.BytesIO(DATA), (None,))
+        next(slicer)
+        with self.assertRaises(RuntimeError):
+            slicer.aggregate()
+
+        slicer = JsonSlicer(io.BytesIO(DATA), (None,))
+        slicer.aggregate()
+        with self.assertRaises(RuntimeError):
+            slicer.aggregate()
+
+    def test_bad_args(self):
+        with self.assertRaises(TypeError):
+            aggregate(DATA, (None,), sum=1.5)
+        with self.assertRaises(ValueError):
+            aggregate(DATA, (None,), sum=(..., 'amount'))
+        with self.assertRaises(TypeError):
+            JsonSlicer(io.BytesIO(DATA), (None,)).aggregate('amount')
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,99 @@
+# Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+
+
+import unittest
+
+import jsonslicer
+
+from .common import run_js
+
+
+DATA = b'''{
+    "id": 1,
+    "items": [
+        {"id": 2, "children": [{"id": 3}, {"name": "x", "sub": {"id": 4}}]},
+        [{"id": 5}],
+        {"ids": [6]}
+    ],
+    "meta": {"owner": {"id": 7, "name": "y"}}
+}'''
+
+
+class TestJsonSlicerAnyDepth(unittest.TestCase):
+    def test_any_key(self):
+        # top level id is matched as a whole, so ids inside it are not reported
+        self.assertEqual(run_js(DATA, (..., 'id')), [1, 2, 3, 4, 5, 7])
+
+    def test_constant(self):
+        self.assertIs(jsonslicer.ANY_DEPTH, ...)
+        self.assertEqual(run_js(DATA, (jsonslicer.ANY_DEPTH, 'name')), ['x', 'y'])
+
+    def test_prefix(self):
+        self.assertEqual(run_js(DATA, ('items', ..., 'id')), [2, 3, 4, 5])
+        self.assertEqual(run_js(DATA, ('meta', ..., 'id')), [7])
+
+    def test_zero_depth(self):
+        self.assertEqual(run_js(DATA, ('meta', ..., 'owner', 'id')), [7])
+        self.assertEqual(run_js(DATA, ('id', ...)), [1])
+
+    def test_in_middle(self):
+        self.assertEqual(run_js(DATA, ('items', ..., 'children', None, 'id')), [3])
+        self.assertEqual(run_js(DATA, (..., 'children', ..., 'id')), [3, 4])
+
+    def test_array_indexes(self):
+        self.assertEqual(run_js(DATA, (..., 0, 'id')), [2, 3, 5])
+        self.assertEqual(run_js(DATA, (..., 'ids', 0)), [6])
+
+    def test_path_mode(self):
+        self.assertEqual(
+            run_js(DATA, ('items', ..., 'id'), path_mode='full'),
+            [
+                ('items', 0, 'id', 2),
+                ('items', 0, 'children', 0, 'id', 3),
+                ('items', 0, 'children', 1, 'sub', 'id', 4),
+                ('items', 1, 0, 'id', 5),
+            ]
+        )
+
+    def test_multiple_patterns(self):
+        self.assertEqual(
+            run_js(DATA, [(..., 'id'), (..., 'name'), ('meta', ...)]),
+            [(0, 1), (0, 2), (0, 3), (1, 'x'), (0, 4), (0, 5), (2, {'owner': {'id': 7, 'name': 'y'}})]
+        )
+
+    def test_fast_skip(self):
+        for fast_skip in (True, False):
+            self.assertEqual(run_js(DATA, ('meta', ..., 'name'), fast_skip=fast_skip, read_size=5), ['y'])
+
+    def test_deep(self):
+        depth = 1000
+        data = b'{"a":' * depth + b'{"id": 1}' + b'}' * depth
+        self.assertEqual(run_js(data, (..., 'id')), [1])
+
+    def test_unsupported(self):
+        with self.assertRaises(ValueError):
+            run_js(DATA, (None,), fields=[(..., 'id')])
+        with self.assertRaises(ValueError):
+            run_js(DATA, (None,), where=[((..., 'id'), '==', 1)])
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -19,6 +19,7 @@
 # THE SOFTWARE.
 
 import io
+import tempfile
 import unittest
 
 from jsonslicer import JsonSlicer
@@ -42,6 +43,41 @@ class TestJsonSlicerBasic(unittest.TestCase):
         self.assertIsNotNone(JsonSlicer(io.StringIO('0'), ()))
         self.assertIsNotNone(next(JsonSlicer(io.BytesIO(b'0'), ())))
 
+    def test_accepts_readinto_only(self):
+        class Reader:
+            def __init__(self, data):
+                self.data = data
+
+            def readinto(self, buffer):
+                size = min(3, len(buffer), len(self.data))
+                buffer[:size] = self.data[:size]
+                self.data = self.data[size:]
+                return size
+
+        self.assertEqual(list(JsonSlicer(Reader(b'[1,2,"foo"]'), (None,))), [1, 2, 'foo'])
+
+    def test_accepts_read_only(self):
+        class Reader:
+            def __init__(self, data):
+                self.data = data
+
+            def read(self, size):
+                result, self.data = self.data[:size], self.data[size:]
+                return result
+
+        self.assertEqual(list(JsonSlicer(Reader(b'[1,2,"foo"]'), (None,), read_size=2)), [1, 2, 'foo'])
+
+    def test_accepts_files(self):
+        with tempfile.TemporaryFile() as tmp:
+            tmp.write(b'[1,2,"foo"]')
+
+            tmp.seek(0)
+            self.assertEqual(list(JsonSlicer(tmp, (None,), read_size=2)), [1, 2, 'foo'])
+
+            tmp.seek(0)
+            with open(tmp.fileno(), 'r', closefd=False) as text:
+                self.assertEqual(list(JsonSlicer(text, (None,), read_size=2)), [1, 2, 'foo'])
+
 
 if __name__ == '__main__':
     unittest.main()
@@ -0,0 +1,73 @@
+# Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+
+import io
+import unittest
+
+from jsonslicer import JsonSlicer
+
+
+class TestJsonSlicerBatch(unittest.TestCase):
+    def test_next_batch(self):
+        gen = JsonSlicer(io.BytesIO(b'[1,2,3,4,5,6,7]'), (None,), read_size=2)
+        self.assertEqual(gen.next_batch(3), [1, 2, 3])
+        self.assertEqual(gen.next_batch(3), [4, 5, 6])
+        self.assertEqual(gen.next_batch(3), [7])
+        self.assertEqual(gen.next_batch(3), [])
+
+    def test_mixed_with_next(self):
+        gen = JsonSlicer(io.BytesIO(b'[1,2,3,4,5]'), (None,))
+        self.assertEqual(next(gen), 1)
+        self.assertEqual(gen.next_batch(2), [2, 3])
+        self.assertEqual(list(gen), [4, 5])
+
+    def test_collect(self):
+        gen = JsonSlicer(io.BytesIO(b'[1,2,{"a":3},[4]]'), (None,), path_mode='full', read_size=1)
+        self.assertEqual(next(gen), (0, 1))
+        self.assertEqual(gen.collect(), [(1, 2), (2, {'a': 3}), (3, [4])])
+        self.assertEqual(gen.collect(), [])
+
+    def test_bad_size(self):
+        gen = JsonSlicer(io.BytesIO(b'[]'), (None,))
+        with self.assertRaises(ValueError):
+            gen.next_batch(0)
+        with self.assertRaises(TypeError):
+            gen.next_batch('foo')
+
+    def test_error_deferred(self):
+        gen = JsonSlicer(io.BytesIO(b'[1,2,}'), (None,), read_size=1)
+        self.assertEqual(gen.next_batch(10), [1, 2])
+        with self.assertRaises(RuntimeError):
+            gen.next_batch(10)
+
+    def test_error_deferred_to_next(self):
+        gen = JsonSlicer(io.BytesIO(b'[1,2,}'), (None,), read_size=1)
+        self.assertEqual(gen.collect(), [1, 2])
+        with self.assertRaises(RuntimeError):
+            next(gen)
+
+    def test_error_immediate(self):
+        gen = JsonSlicer(io.BytesIO(b'}'), (None,))
+        with self.assertRaises(RuntimeError):
+            gen.collect()
+
+
+if __name__ == '__main__':
+    unittest.main()
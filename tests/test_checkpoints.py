@@ -0,0 +1,172 @@
+# Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+
+
+
+
+import io
+import json
+import os
+import tempfile
+import unittest
+
+from jsonslicer import JsonSlicer
+
+
+DATA = b'{"meta": {"a": 1}, "items": [1, {"a": [2, 3]}, "x", null, [4], {"a": 5, "b": {"c": 6}}, 7.5, "y"]}'
+
+PATTERNS = [
+    ('items', None),
+    ('items', None, 'a'),
+    (None, None),
+    ('items', None, None),
+    (),
+]
+
+
+class TestJsonSlicerCheckpoints(unittest.TestCase):
+    def check_resume(self, data, pattern, **kwargs):
+        expected = list(JsonSlicer(io.BytesIO(data), pattern, **kwargs))
+
+        for taken in range(len(expected) + 1):
+            slicer = JsonSlicer(io.BytesIO(data), pattern, checkpoints=True, **kwargs)
+            head = [next(slicer) for _ in range(taken)]
+            checkpoint = slicer.checkpoint()
+
+            # resumed instance provides checkpoints too
+            slicer = JsonSlicer(io.BytesIO(data), pattern, checkpoints=True, **kwargs)
+            slicer.resume(checkpoint)
+            tail = slicer.next_batch(1)
+            checkpoint = slicer.checkpoint()
+
+            slicer = JsonSlicer(io.BytesIO(data), pattern, **kwargs)
+            slicer.resume(checkpoint)
+            tail += list(slicer)
+
+            self.assertEqual(head + tail, expected, (pattern, kwargs, taken))
+
+    def test_resume(self):
+        for pattern in PATTERNS:
+            self.check_resume(DATA, pattern)
+
+    def test_resume_options(self):
+        for pattern in PATTERNS:
+            for kwargs in [{'path_mode': 'full'}, {'output': 'raw'}, {'fast_skip': False}, {'read_size': 3}, {'where': [('a', '==', 5)]}]:
+                self.check_resume(DATA, pattern, **kwargs)
+
+    def test_dump_ndjson(self):
+        data = b'{"items": [1, 0.1, {"a": 1e400}, 2.50]}'
+        slicer = JsonSlicer(io.BytesIO(data), ('items', None), checkpoints=True)
+        self.assertEqual(next(slicer), 1)
+        checkpoint = slicer.checkpoint()
+
+        # numbers are written as is after resume too
+        slicer = JsonSlicer(io.BytesIO(data), ('items', None))
+        slicer.resume(checkpoint)
+        output = io.BytesIO()
+        slicer.dump_ndjson(output)
+        self.assertEqual(output.getvalue(), b'0.1\n{"a":1e400}\n2.50\n')
+
+    def test_multiple_patterns(self):
+        # a value matched by multiple patterns is returned again, unless
+        # all of its copies were returned before the checkpoint
+        slicer = JsonSlicer(io.BytesIO(b'[[1, 2], [3]]'), [(None, None), (None, 1)], checkpoints=True)
+        self.assertEqual([next(slicer) for _ in range(2)], [(0, 1), (0, 2)])
+        checkpoint = slicer.checkpoint()
+        self.assertEqual(next(slicer), (1, 2))
+
+        slicer = JsonSlicer(io.BytesIO(b'[[1, 2], [3]]'), [(None, None), (None, 1)])
+        slicer.resume(checkpoint)
+        self.assertEqual(list(slicer), [(0, 2), (1, 2), (0, 3)])
+
+    def test_files(self):
+        data = json.dumps({'items': [{'id': i, 'tags': ['t'] * (i % 5)} for i in range(1000)]}).encode('utf-8')
+
+        with tempfile.TemporaryDirectory() as tmpdir:
+            input_path = os.path.join(tmpdir, 'input.json')
+            with open(input_path, 'wb') as fd:
+                fd.write(data)
+
+            slicer = JsonSlicer(input_path, ('items', None), checkpoints=True)
+            for _ in range(500):
+                next(slicer)
+            checkpoint = slicer.checkpoint()
+
+            slicer = JsonSlicer(input_path, ('items', None))
+            slicer.resume(checkpoint)
+            self.assertEqual([item['id'] for item in slicer], list(range(500, 1000)))
+
+            with open(input_path, 'rb') as fd:
+                slicer = JsonSlicer(fd.fileno(), ('items', None), read_size=100)
+                slicer.resume(checkpoint)
+                self.assertEqual(next(slicer)['id'], 500)
+
+            with open(input_path, 'rb') as fd:
+                slicer = JsonSlicer(fd, ('items', None), read_size=100)
+                slicer.resume(checkpoint)
+                self.assertEqual(next(slicer)['id'], 500)
+
+            # text stream positions are not byte offsets
+            with open(input_path, 'r') as fd:
+                slicer = JsonSlicer(fd, ('items', None))
+                with self.assertRaisesRegex(ValueError, 'binary mode'):
+                    slicer.resume(checkpoint)
+
+    def test_seek(self):
+        index = io.BytesIO()
+        JsonSlicer(io.BytesIO(DATA), ('items', None)).build_index(index, every=3)
+
+        slicer = JsonSlicer(io.BytesIO(DATA), ('items', None), checkpoints=True)
+        slicer.seek(4, io.BytesIO(index.getvalue()))
+        checkpoint = slicer.checkpoint()
+
+        slicer = JsonSlicer(io.BytesIO(DATA), ('items', None))
+        slicer.resume(checkpoint)
+        self.assertEqual(next(slicer), [4])
+
+    def test_errors(self):
+        with self.assertRaises(ValueError):
+            JsonSlicer(io.BytesIO(DATA), (None,)).checkpoint()
+
+        with self.assertRaises(ValueError):
+            JsonSlicer(io.BytesIO(DATA), (None,)).resume(b'garbage')
+
+        with self.assertRaises(TypeError):
+            JsonSlicer(io.BytesIO(DATA), (None,)).resume('garbage')
+
+        with tempfile.TemporaryDirectory() as tmpdir:
+            input_path = os.path.join(tmpdir, 'input.json')
+            with open(input_path, 'wb') as fd:
+                fd.write(DATA)
+            with self.assertRaises(ValueError):
+                JsonSlicer(input_path, (None,), pipelined=True, checkpoints=True)
+
+        slicer = JsonSlicer(io.BytesIO(DATA), ('items', None), checkpoints=True)
+        next(slicer)
+        checkpoint = slicer.checkpoint()
+        with self.assertRaises(RuntimeError):
+            slicer.resume(checkpoint)
+
+        with self.assertRaises(ValueError):
+            JsonSlicer(io.BytesIO(DATA), ('meta', None)).resume(checkpoint)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -105,6 +105,43 @@ class TestJsonSlicerEncodings(unittest.TestCase):
             [b'bar']
         )
 
+    def test_encodings_non_ascii(self):
+        self.assertEqual(
+            run_js('{"ключ":["значение","mixed значение","é"]}'.encode('utf-8'), ('ключ',)),
+            [['значение', 'mixed значение', 'é']]
+        )
+
+    def test_encodings_long_ascii(self):
+        value = 'x' * 1000
+        self.assertEqual(
+            run_js('{"foo":"%s","bar":"%sé"}' % (value, value), ('bar',)),
+            [value + 'é']
+        )
+
+    def test_encodings_utf8_errors(self):
+        self.assertEqual(
+            run_js(b'["a\xffb"]', (None,), yajl_dont_validate_strings=True, errors='replace'),
+            ['a\ufffdb']
+        )
+        with self.assertRaises(UnicodeDecodeError):
+            run_js(b'["a\xffb"]', (None,), yajl_dont_validate_strings=True)
+
+    def test_encodings_latin1(self):
+        self.assertEqual(
+            run_js(b'{"foo":"caf\xe9"}', ('foo',), encoding='latin-1', yajl_dont_validate_strings=True),
+            ['caf\xe9']
+        )
+
+    def test_encodings_codec(self):
+        self.assertEqual(
+            run_js('{"ключ":"значение"}'.encode('cp1251'), ('ключ',), encoding='cp1251', yajl_dont_validate_strings=True),
+            ['значение']
+        )
+
+    def test_encodings_unknown(self):
+        with self.assertRaises(LookupError):
+            run_js(b'{}', (), encoding='no-such-encoding')
+
 
 if __name__ == '__main__':
     unittest.main()
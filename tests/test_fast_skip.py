@@ -0,0 +1,80 @@
+# Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+
+import io
+import json
+import unittest
+
+from jsonslicer import JsonSlicer
+
+
+DATA = {
+    'skipped': {
+        'strings': ['"quoted" {not} [a] container', '\\', '\\"', '\\\\"]', 'x' * 100 + '}]' * 50],
+        'nested': [[[[{'a': [{}]}]]], {'b': {'c': []}}] * 10,
+        'unicode': ['тест {', '"]'],
+        'plain': ['}]' * 30, '[{' * 30, {'k%d' % i: ']' if i % 2 else '[' for i in range(30)}],
+    },
+    'items': [
+        {'id': 1, 'skipped': {'a': ['}' * 40]}, 'name': 'first'},
+        {'id': 2, 'skipped': [[], [[]], '[' * 70], 'name': 'second'},
+        [{'name': 'not matched'}],
+        {'id': 3, 'name': {'nested': '{}"'}},
+    ],
+    'more': [{'name': 'not matched'}] * 20,
+}
+
+
+def run_js(data, path, read_size, **kwargs):
+    return list(JsonSlicer(io.BytesIO(data), path, read_size=read_size, **kwargs))
+
+
+class TestJsonSlicerFastSkip(unittest.TestCase):
+    def test_fast_skip(self):
+        data = json.dumps(DATA, ensure_ascii=False).encode('utf-8')
+
+        for path in [('items', None, 'name'), ('items', None, 'id'), ('more', 1), (None, None, 'name')]:
+            expected = run_js(data, path, 1024, path_mode='full')
+
+            for read_size in [1, 2, 3, 5, 16, 33, 1024, 100000]:
+                with self.subTest(path=path, read_size=read_size):
+                    self.assertEqual(run_js(data, path, read_size, path_mode='full', fast_skip=True), expected)
+
+    def test_fast_skip_partial(self):
+        data = b'{"a":{"b":[1,2,3'
+
+        with self.assertRaises(RuntimeError):
+            run_js(data, ('c',), 4, fast_skip=True)
+
+        self.assertEqual(run_js(data, ('c',), 4, fast_skip=True, yajl_allow_partial_values=True), [])
+
+    def test_fast_skip_error_after_skip(self):
+        with self.assertRaises(RuntimeError):
+            run_js(b'{"a":{"b":1},"c":tru}', ('c',), 4, fast_skip=True)
+
+    def test_fast_skip_multiple_values(self):
+        self.assertEqual(
+            run_js(b'{"a":[1],"b":2} {"a":{},"b":3}', ('b',), 3, fast_skip=True, yajl_allow_multiple_values=True),
+            [2, 3]
+        )
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,103 @@
+# Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+
+import unittest
+
+from .common import run_js
+
+
+DATA = b'''[
+    {"id": 1, "name": "foo", "tags": ["a", "b"], "meta": {"created": 100, "updated": 200, "author": {"name": "x", "email": "y"}}},
+    {"id": 2, "name": "bar", "extra": [{"deep": [1, 2, 3]}], "meta": null},
+    {"name": "baz"}
+]'''
+
+
+class TestJsonSlicerFields(unittest.TestCase):
+    def test_top_level_keys(self):
+        self.assertEqual(
+            run_js(DATA, (None,), fields=('id', 'name')),
+            [{'id': 1, 'name': 'foo'}, {'id': 2, 'name': 'bar'}, {'name': 'baz'}]
+        )
+
+    def test_container_values(self):
+        self.assertEqual(
+            run_js(DATA, (None,), fields=['tags', 'meta']),
+            [{'tags': ['a', 'b'], 'meta': {'created': 100, 'updated': 200, 'author': {'name': 'x', 'email': 'y'}}}, {'meta': None}, {}]
+        )
+
+    def test_nested(self):
+        self.assertEqual(
+            run_js(DATA, (None,), fields=[('meta', 'created'), ('meta', 'author', 'email'), 'id']),
+            [{'id': 1, 'meta': {'created': 100, 'author': {'email': 'y'}}}, {'id': 2}, {}]
+        )
+
+    def test_nested_and_whole(self):
+        self.assertEqual(
+            run_js(DATA, (0,), fields=[('meta', 'created'), 'meta']),
+            [{'meta': {'created': 100, 'updated': 200, 'author': {'name': 'x', 'email': 'y'}}}]
+        )
+
+    def test_wildcards(self):
+        self.assertEqual(
+            run_js(DATA, (0,), fields=[('meta', None, 'name'), ('meta', 'created')]),
+            [{'meta': {'created': 100, 'author': {'name': 'x'}}}]
+        )
+        self.assertEqual(
+            run_js(DATA, (None,), fields=[('extra', None, 'deep', 1)]),
+            [{}, {'extra': [{'deep': [2]}]}, {}]
+        )
+
+    def test_array_indexes(self):
+        self.assertEqual(
+            run_js(DATA, (0,), fields=[('tags', 1)]),
+            [{'tags': ['b']}]
+        )
+        self.assertEqual(
+            run_js(b'[[1,2,3],[4,5]]', (None,), fields=[2, 0]),
+            [[1, 3], [4]]
+        )
+
+    def test_empty(self):
+        self.assertEqual(run_js(DATA, (None,), fields=()), [{}, {}, {}])
+        self.assertEqual(run_js(DATA, (None,), fields=[()]), run_js(DATA, (None,)))
+
+    def test_scalars_unaffected(self):
+        self.assertEqual(run_js(DATA, (None, 'name'), fields=('id',)), ['foo', 'bar', 'baz'])
+
+    def test_path_modes(self):
+        self.assertEqual(
+            run_js(DATA, (None,), fields=('id',), path_mode='full'),
+            [(0, {'id': 1}), (1, {'id': 2}), (2, {})]
+        )
+
+    def test_encodings(self):
+        self.assertEqual(run_js(DATA, (None,), fields=(b'id',)), [{'id': 1}, {'id': 2}, {}])
+        self.assertEqual(run_js(DATA, (None,), fields=('id',), binary=True), [{b'id': 1}, {b'id': 2}, {}])
+
+    def test_bad_fields(self):
+        with self.assertRaises(TypeError):
+            run_js(DATA, (None,), fields=1.5)
+        with self.assertRaises(TypeError):
+            run_js(DATA, (None,), fields=[1.5])
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,77 @@
+# Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+
+import io
+import unittest
+
+from jsonslicer import JsonSlicer
+
+
+class TestJsonSlicerKeyCache(unittest.TestCase):
+    def test_keys_shared(self):
+        a, b = JsonSlicer(io.BytesIO(b'[{"name":1},{"name":2}]'), (None,))
+        self.assertEqual(a, {'name': 1})
+        self.assertEqual(b, {'name': 2})
+        self.assertIs(list(a)[0], list(b)[0])
+
+    def test_path_keys_shared(self):
+        a, b = JsonSlicer(io.BytesIO(b'{"x":{"name":1},"y":{"name":2}}'), (None, 'name'), path_mode='full')
+        self.assertEqual(a, ('x', 'name', 1))
+        self.assertEqual(b, ('y', 'name', 2))
+        self.assertIs(a[1], b[1])
+
+    def test_keys_binary(self):
+        a, b = JsonSlicer(io.BytesIO(b'[{"name":1},{"name":2}]'), (None,), binary=True)
+        self.assertEqual(a, {b'name': 1})
+        self.assertIs(list(a)[0], list(b)[0])
+
+    def test_values_not_shared_by_default(self):
+        a, b = JsonSlicer(io.BytesIO(b'["active","active"]'), (None,))
+        self.assertEqual(a, 'active')
+        self.assertEqual(b, 'active')
+        self.assertIsNot(a, b)
+
+    def test_values_shared(self):
+        a, b, c = JsonSlicer(io.BytesIO(b'[{"status":"active"},{"status":"active"},"active"]'), (None,), intern_values=True)
+        self.assertEqual(a, {'status': 'active'})
+        self.assertIs(a['status'], b['status'])
+        self.assertIs(a['status'], c)
+
+    def test_long_keys(self):
+        key = 'k' * 1000
+        data = '[{"%s":1},{"%s":2}]' % (key, key)
+        self.assertEqual(list(JsonSlicer(io.StringIO(data), (None,))), [{key: 1}, {key: 2}])
+
+    def test_many_keys(self):
+        # much more distinct keys than cache slots
+        data = '[' + ','.join('{"key%d":%d,"value":%d}' % (i, i, i) for i in range(5000)) + ']'
+        expected = [{'key%d' % i: i, 'value': i} for i in range(5000)]
+        self.assertEqual(list(JsonSlicer(io.StringIO(data), (None,))), expected)
+        self.assertEqual(list(JsonSlicer(io.StringIO(data), (None,), intern_values=True)), expected)
+
+    def test_unicode_keys(self):
+        self.assertEqual(
+            list(JsonSlicer(io.BytesIO('[{"ключ":1},{"ключ":2}]'.encode('utf-8')), (None,))),
+            [{'ключ': 1}, {'ключ': 2}]
+        )
+
+
+if __name__ == '__main__':
+    unittest.main()
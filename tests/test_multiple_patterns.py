@@ -0,0 +1,97 @@
+# Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+
+
+import unittest
+
+from .common import run_js
+
+
+DATA = b'''{
+    "users": [{"id": 1, "name": "foo"}, {"id": 2, "name": "bar"}],
+    "groups": {"admins": [1], "guests": [2, 3]},
+    "version": 3
+}'''
+
+
+class TestJsonSlicerMultiplePatterns(unittest.TestCase):
+    def test_basic(self):
+        self.assertEqual(
+            run_js(DATA, [('users', None), ('groups', None), ('version',)]),
+            [(0, {'id': 1, 'name': 'foo'}), (0, {'id': 2, 'name': 'bar'}), (1, [1]), (1, [2, 3]), (2, 3)]
+        )
+
+    def test_single_in_list(self):
+        self.assertEqual(run_js(DATA, [('version',)]), [(0, 3)])
+        # single pattern as a list of path elements
+        self.assertEqual(run_js(DATA, ['version']), [3])
+        self.assertEqual(run_js(DATA, []), [{'users': [{'id': 1, 'name': 'foo'}, {'id': 2, 'name': 'bar'}], 'groups': {'admins': [1], 'guests': [2, 3]}, 'version': 3}])
+
+    def test_overlapping(self):
+        # same value matched by multiple patterns is returned for each
+        self.assertEqual(
+            run_js(DATA, [('users', 0, 'id'), ('users', None, 'id'), (None, 0, None)]),
+            [(0, 1), (1, 1), (2, 1), (2, 'foo'), (1, 2)]
+        )
+
+    def test_nested(self):
+        # matches inside already matched value are not reported
+        self.assertEqual(
+            run_js(DATA, [('groups',), ('groups', 'admins')]),
+            [(0, {'admins': [1], 'guests': [2, 3]})]
+        )
+
+    def test_never_matching(self):
+        self.assertEqual(run_js(DATA, [('users', -1), ('version',), ('missing',)]), [(1, 3)])
+
+    def test_path_modes(self):
+        self.assertEqual(
+            run_js(DATA, [('groups', None), ('version',)], path_mode='map_keys'),
+            [(0, 'admins', [1]), (0, 'guests', [2, 3]), (1, 'version', 3)]
+        )
+        self.assertEqual(
+            run_js(DATA, [('users', None, 'id'), ('groups', 'guests', None)], path_mode='full'),
+            [(0, 'users', 0, 'id', 1), (0, 'users', 1, 'id', 2), (1, 'groups', 'guests', 0, 2), (1, 'groups', 'guests', 1, 3)]
+        )
+        self.assertEqual(run_js(b'[1]', [()], path_mode='full'), [(0, [1])])
+
+    def test_many_patterns(self):
+        data = b'{' + b','.join(b'"k%d": %d' % (i, i) for i in range(100)) + b'}'
+        patterns = [('k%d' % i,) for i in range(0, 100, 3)]
+        self.assertEqual(run_js(data, patterns), [(i // 3, i) for i in range(0, 100, 3)])
+
+        data = b'[' + b','.join(b'%d' % i for i in range(100)) + b']'
+        patterns = [(i,) for i in range(0, 100, 3)]
+        self.assertEqual(run_js(data, patterns), [(i // 3, i) for i in range(0, 100, 3)])
+
+    def test_fast_skip(self):
+        for fast_skip in (True, False):
+            self.assertEqual(
+                run_js(DATA, [('groups', 'guests'), ('version',)], fast_skip=fast_skip, read_size=3),
+                [(0, [2, 3]), (1, 3)]
+            )
+
+    def test_bad_args(self):
+        with self.assertRaises(TypeError):
+            run_js(DATA, [('version',), 'users'])
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,95 @@
+# Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+
+import os
+import pathlib
+import tempfile
+import unittest
+
+from jsonslicer import JsonSlicer
+
+
+class TestJsonSlicerNativeInput(unittest.TestCase):
+    def setUp(self):
+        self.dir = tempfile.TemporaryDirectory()
+        self.path = os.path.join(self.dir.name, 'input.json')
+        with open(self.path, 'wb') as fd:
+            fd.write('{"a":[1,2,"é"],"b":{"c":3}}'.encode('utf-8'))
+
+    def tearDown(self):
+        self.dir.cleanup()
+
+    def test_path_str(self):
+        for read_size in [1, 2, 3, 1024]:
+            self.assertEqual(list(JsonSlicer(self.path, ('a', None), read_size=read_size)), [1, 2, 'é'])
+
+    def test_path_bytes(self):
+        self.assertEqual(list(JsonSlicer(os.fsencode(self.path), ('a', None))), [1, 2, 'é'])
+
+    def test_path_pathlike(self):
+        self.assertEqual(list(JsonSlicer(pathlib.Path(self.path), ('a', None))), [1, 2, 'é'])
+
+    def test_path_binary(self):
+        self.assertEqual(list(JsonSlicer(self.path, ('a', None), binary=True)), [1, 2, 'é'.encode('utf-8')])
+
+    def test_path_missing(self):
+        with self.assertRaises(FileNotFoundError):
+            JsonSlicer(os.path.join(self.dir.name, 'missing.json'), ())
+
+    def test_path_empty(self):
+        open(self.path, 'wb').close()
+        with self.assertRaises(RuntimeError):
+            list(JsonSlicer(self.path, ()))
+
+    def test_descriptor(self):
+        fd = os.open(self.path, os.O_RDONLY)
+        try:
+            self.assertEqual(list(JsonSlicer(fd, ('b', 'c'), read_size=2)), [3])
+        finally:
+            os.close(fd)
+
+    def test_descriptor_offset(self):
+        with open(self.path, 'rb') as fd:
+            fd.seek(5)
+            self.assertEqual(list(JsonSlicer(fd.fileno(), (None,), yajl_allow_trailing_garbage=True)), [1, 2, 'é'])
+
+    def test_descriptor_bad(self):
+        with self.assertRaises(ValueError):
+            JsonSlicer(-1, ())
+
+    def test_pipe(self):
+        rfd, wfd = os.pipe()
+        try:
+            os.write(wfd, b'[1,[2,3],4]')
+            os.close(wfd)
+            wfd = None
+            self.assertEqual(list(JsonSlicer(rfd, (None,), read_size=3)), [1, [2, 3], 4])
+        finally:
+            os.close(rfd)
+            if wfd is not None:
+                os.close(wfd)
+
+    def test_bad_read_size(self):
+        with self.assertRaises(ValueError):
+            JsonSlicer(self.path, (), read_size=0)
+
+
+if __name__ == '__main__':
+    unittest.main()
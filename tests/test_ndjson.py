@@ -0,0 +1,141 @@
+# Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+
+
+
+import io
+import os
+import tempfile
+import unittest
+
+from jsonslicer import JsonSlicer
+
+
+DATA = b'[{"id": 1, "tags": ["a"]}, {"id": 2, "tags": []}, 0.5, "str", {"id": 3, "size": 1.0e3}]'
+
+
+class TestJsonSlicerNdjson(unittest.TestCase):
+    def test_python_output(self):
+        output = io.BytesIO()
+        stats = JsonSlicer(io.BytesIO(DATA), (None,), output='raw').dump_ndjson(output)
+        self.assertEqual(
+            output.getvalue(),
+            b'{"id":1,"tags":["a"]}\n{"id":2,"tags":[]}\n0.5\n"str"\n{"id":3,"size":1.0e3}\n'
+        )
+        self.assertEqual(stats, {'objects': 5, 'bytes': len(output.getvalue())})
+
+    def test_path_output(self):
+        with tempfile.TemporaryDirectory() as tmpdir:
+            input_path = os.path.join(tmpdir, 'input.json')
+            output_path = os.path.join(tmpdir, 'output.ndjson')
+            with open(input_path, 'wb') as fd:
+                fd.write(DATA)
+            with open(output_path, 'wb') as fd:
+                fd.write(b'garbage which is overwritten' * 10000)
+
+            for pipelined in [False, True]:
+                stats = JsonSlicer(input_path, (None, 'id'), pipelined=pipelined).dump_ndjson(output_path)
+                with open(output_path, 'rb') as fd:
+                    self.assertEqual(fd.read(), b'1\n2\n3\n')
+                self.assertEqual(stats, {'objects': 3, 'bytes': 6})
+
+    def test_descriptor_output(self):
+        with tempfile.TemporaryFile() as output:
+            JsonSlicer(io.BytesIO(DATA), (None, 'tags')).dump_ndjson(output.fileno())
+            output.seek(0)
+            self.assertEqual(output.read(), b'["a"]\n[]\n')
+
+    def test_large_output(self):
+        data = b'[' + b','.join(b'{"n":%d}' % i for i in range(50000)) + b']'
+        output = io.BytesIO()
+        stats = JsonSlicer(io.BytesIO(data), (None,), output='raw').dump_ndjson(output)
+        self.assertEqual(stats['objects'], 50000)
+        self.assertEqual(output.getvalue().splitlines(), [b'{"n":%d}' % i for i in range(50000)])
+
+    def test_options(self):
+        output = io.BytesIO()
+        slicer = JsonSlicer(
+            io.BytesIO(DATA),
+            [(None,), (None,)],
+            output='raw',
+            path_mode='full',
+            fields=['id'],
+            where=[('id', '>=', 2)]
+        )
+        slicer.dump_ndjson(output)
+
+        # paths are not written, values matched by multiple patterns
+        # are written once
+        self.assertEqual(output.getvalue(), b'{"id":2}\n{"id":3}\n')
+
+    def test_fields(self):
+        # scalars whose subfields are selected are dropped along with
+        # their keys
+        data = b'[{"c": 1, "a": "y", "b": 2, "d": {"x": 1, "y": 2}}, {"a": {"c": 3}, "b": [4]}]'
+        output = io.BytesIO()
+        stats = JsonSlicer(io.BytesIO(data), (None,), fields=[('a', 'c'), ('b', 'c'), ('d', 'x'), 'c']).dump_ndjson(output)
+        self.assertEqual(output.getvalue(), b'{"c":1,"d":{"x":1}}\n{"a":{"c":3},"b":[]}\n')
+        self.assertEqual(stats['objects'], 2)
+
+    def test_numbers(self):
+        # numbers are written as is in any output mode
+        data = b'[1.0e3, 100000000000000000000, 0.1, 1e400, -0.0, {"x": [2.50]}]'
+        expected = b'1.0e3\n100000000000000000000\n0.1\n1e400\n-0.0\n{"x":[2.50]}\n'
+
+        with tempfile.NamedTemporaryFile() as input_file:
+            input_file.write(data)
+            input_file.flush()
+
+            for output_mode in ['objects', 'raw']:
+                for options in [{}, {'pipelined': True}, {'threads': 2, 'read_size': 8}]:
+                    with self.subTest(output_mode=output_mode, options=options):
+                        output = io.BytesIO()
+                        JsonSlicer(input_file.name, (None,), output=output_mode, **options).dump_ndjson(output)
+                        self.assertEqual(output.getvalue(), expected)
+
+    def test_output_mode_kept(self):
+        slicer = JsonSlicer(io.BytesIO(b'[0.1]'), (None,))
+        with self.assertRaises(OSError):
+            slicer.dump_ndjson('/nonexistent/output.ndjson')
+        # still iterated as objects
+        self.assertEqual(list(slicer), [0.1])
+
+    def test_after_iteration(self):
+        slicer = JsonSlicer(io.BytesIO(DATA), (None,))
+        next(slicer)
+        with self.assertRaises(RuntimeError):
+            slicer.dump_ndjson(io.BytesIO())
+
+    def test_exhausts_slicer(self):
+        slicer = JsonSlicer(io.BytesIO(DATA), (None,))
+        slicer.dump_ndjson(io.BytesIO())
+        self.assertEqual(list(slicer), [])
+
+    def test_errors(self):
+        with self.assertRaises(RuntimeError):
+            JsonSlicer(io.BytesIO(b'[1, 2'), (None,)).dump_ndjson(io.BytesIO())
+        with self.assertRaises(AttributeError):
+            JsonSlicer(io.BytesIO(DATA), (None,)).dump_ndjson(object())
+        with self.assertRaises(OSError):
+            JsonSlicer(io.BytesIO(DATA), (None,)).dump_ndjson('/nonexistent/output.ndjson')
+
+
+if __name__ == '__main__':
+    unittest.main()
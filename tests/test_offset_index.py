@@ -0,0 +1,132 @@
+# Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+
+
+
+
+import io
+import json
+import os
+import tempfile
+import unittest
+
+from jsonslicer import JsonSlicer
+
+
+DATA = b'{"meta": {"a": 1}, "items": [1, {"a": [2, 3]}, "x", null, [4], {"a": 5, "b": {"c": 6}}, 7.5, "y"]}'
+
+PATTERNS = [
+    ('items', None),
+    ('items', None, 'a'),
+    (None, None),
+    ('items', None, None),
+]
+
+
+class TestJsonSlicerOffsetIndex(unittest.TestCase):
+    def check_seek(self, data, pattern, every, **kwargs):
+        index = io.BytesIO()
+        JsonSlicer(io.BytesIO(data), pattern).build_index(index, every=every)
+        expected = list(JsonSlicer(io.BytesIO(data), pattern, **kwargs))
+
+        for match in range(len(expected) + 2):
+            slicer = JsonSlicer(io.BytesIO(data), pattern, **kwargs)
+            slicer.seek(match, io.BytesIO(index.getvalue()))
+            self.assertEqual(list(slicer), expected[match:], (pattern, every, kwargs, match))
+
+    def test_seek(self):
+        for pattern in PATTERNS:
+            for every in [1, 2, 3, 100]:
+                self.check_seek(DATA, pattern, every)
+
+    def test_seek_options(self):
+        for pattern in PATTERNS:
+            for kwargs in [{'path_mode': 'full'}, {'output': 'raw'}, {'fast_skip': False}, {'read_size': 3}]:
+                self.check_seek(DATA, pattern, 2, **kwargs)
+
+    def test_stats(self):
+        index = io.BytesIO()
+        self.assertEqual(
+            JsonSlicer(io.BytesIO(DATA), ('items', None)).build_index(index, every=3),
+            {'matches': 8, 'entries': 3}
+        )
+
+    def test_files(self):
+        data = json.dumps({'items': [{'id': i, 'tags': ['t'] * (i % 5)} for i in range(1000)]}).encode('utf-8')
+        expected = list(JsonSlicer(io.BytesIO(data), ('items', None)))
+
+        with tempfile.TemporaryDirectory() as tmpdir:
+            input_path = os.path.join(tmpdir, 'input.json')
+            index_path = os.path.join(tmpdir, 'input.idx')
+            with open(input_path, 'wb') as fd:
+                fd.write(data)
+
+            JsonSlicer(input_path, ('items', None)).build_index(index_path, every=16)
+
+            for match in [0, 15, 16, 17, 500, 999, 1000]:
+                slicer = JsonSlicer(input_path, ('items', None))
+                slicer.seek(match, index_path)
+                self.assertEqual(list(slicer), expected[match:])
+
+                with open(input_path, 'rb') as fd:
+                    slicer = JsonSlicer(fd.fileno(), ('items', None), read_size=100)
+                    slicer.seek(match, index_path)
+                    self.assertEqual(next(slicer, None), (expected[match:] or [None])[0])
+
+    def test_no_matches(self):
+        index = io.BytesIO()
+        JsonSlicer(io.BytesIO(DATA), ('missing', None)).build_index(index)
+        slicer = JsonSlicer(io.BytesIO(DATA), ('missing', None))
+        slicer.seek(0, io.BytesIO(index.getvalue()))
+        self.assertEqual(list(slicer), [])
+
+    def test_errors(self):
+        index = io.BytesIO()
+        JsonSlicer(io.BytesIO(DATA), ('items', None, 'a')).build_index(index)
+
+        with self.assertRaises(ValueError):
+            JsonSlicer(io.BytesIO(DATA), ('meta', 'a')).seek(1, io.BytesIO(index.getvalue()))
+
+        with self.assertRaises(ValueError):
+            JsonSlicer(io.BytesIO(DATA), (None,)).seek(0, io.BytesIO(b'garbage'))
+
+        with self.assertRaises(ValueError):
+            JsonSlicer(io.BytesIO(DATA), (None,)).build_index(io.BytesIO(), every=0)
+
+        with self.assertRaises(ValueError):
+            JsonSlicer(io.BytesIO(DATA), (None,), pipelined=True).build_index(io.BytesIO())
+
+        with self.assertRaises(ValueError):
+            JsonSlicer(io.BytesIO(DATA), (None,), pipelined=True).seek(0, io.BytesIO(index.getvalue()))
+
+        # text stream positions are not byte offsets
+        with self.assertRaisesRegex(ValueError, 'binary mode'):
+            JsonSlicer(io.StringIO(DATA.decode('utf-8')), ('items', None, 'a')).seek(1, io.BytesIO(index.getvalue()))
+
+        slicer = JsonSlicer(io.BytesIO(DATA), ('items', None))
+        next(slicer)
+        with self.assertRaises(RuntimeError):
+            slicer.build_index(io.BytesIO())
+        with self.assertRaises(RuntimeError):
+            slicer.seek(0, io.BytesIO(index.getvalue()))
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -63,6 +63,25 @@ class TestPathModes(unittest.TestCase):
             ]
         )
 
+    def test_path_mode_full_nested(self):
+        self.assertEqual(
+            run_js('{"а":[[{"bb":1,"б":[2,3]}],[{"б":[4]}]]}', ('а', None, None, 'б', None), path_mode='full'),
+            [
+                ('а', 0, 0, 'б', 0, 2),
+                ('а', 0, 0, 'б', 1, 3),
+                ('а', 1, 0, 'б', 0, 4),
+            ]
+        )
+
+    def test_path_mode_map_keys_nested(self):
+        self.assertEqual(
+            run_js('{"a":{"long_key":{"x":1},"k":{"x":2}}}', ('a', None, 'x'), path_mode='map_keys'),
+            [
+                ('x', 1),
+                ('x', 2),
+            ]
+        )
+
 
 if __name__ == '__main__':
     unittest.main()
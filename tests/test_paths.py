@@ -145,6 +145,39 @@ class TestJsonSlicerPaths(unittest.TestCase):
                 result
             )
 
+    def test_pruned_subtrees(self):
+        data = {
+            'data': [
+                {'type': 'a', 'attributes': {'x': 1}, 'relationships': {'attributes': [{'attributes': 0}]}},
+                [{'attributes': 2}],
+                {'attributes': [{'attributes': 3}], 'meta': [[[]], {}]},
+            ],
+            'attributes': {'data': [{'attributes': 4}]},
+        }
+
+        self.assertEqual(
+            run_js(json.dumps(data), ('data', None, 'attributes'), path_mode='full'),
+            [
+                ('data', 0, 'attributes', {'x': 1}),
+                ('data', 2, 'attributes', [{'attributes': 3}]),
+            ]
+        )
+
+    def test_unmatchable_paths(self):
+        cases = [
+            ('a', 'a', -1),
+            ('a', 'a', 2 ** 64),
+            ('a', 'a', 0.0),
+            ('a', 0),
+            (0,),
+        ]
+
+        for path in cases:
+            self.assertEqual(
+                run_js(JSON, path, path_mode='full'),
+                []
+            )
+
 
 if __name__ == '__main__':
     unittest.main()
@@ -0,0 +1,129 @@
+# Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+
+import io
+import os
+import tempfile
+import unittest
+
+from jsonslicer import JsonSlicer
+
+
+class TestJsonSlicerPipelined(unittest.TestCase):
+    def setUp(self):
+        self.dir = tempfile.TemporaryDirectory()
+
+    def tearDown(self):
+        self.dir.cleanup()
+
+    def write(self, data):
+        path = os.path.join(self.dir.name, 'input.json')
+        with open(path, 'wb') as fd:
+            fd.write(data)
+        return path
+
+    def test_same_results(self):
+        path = self.write(b'{"a":[{"b":1,"c":[true,false,null]},{"b":2.5,"d":"\\u00e9"}],"e":{"a":[3]}}')
+
+        for read_size in [1, 2, 3, 7, 1024]:
+            for pattern in [(), ('a',), ('a', None), ('a', None, 'b'), (None, None), ('e', 'a', 0)]:
+                for path_mode in ['ignore', 'map_keys', 'full']:
+                    expected = list(JsonSlicer(path, pattern, read_size=read_size, path_mode=path_mode))
+                    actual = list(JsonSlicer(path, pattern, read_size=read_size, path_mode=path_mode, pipelined=True))
+                    self.assertEqual(actual, expected)
+
+    def test_many_chunks(self):
+        path = self.write(('[' + ','.join('{"id":%d,"name":"item%d"}' % (i, i) for i in range(10000)) + ']').encode('utf-8'))
+
+        self.assertEqual(list(JsonSlicer(path, (None, 'id'), read_size=64, pipelined=True)), list(range(10000)))
+
+    def test_pipe(self):
+        rfd, wfd = os.pipe()
+        try:
+            os.write(wfd, b'[1,2,3]')
+            os.close(wfd)
+            wfd = None
+            self.assertEqual(list(JsonSlicer(rfd, (None,), read_size=2, pipelined=True)), [1, 2, 3])
+        finally:
+            os.close(rfd)
+            if wfd is not None:
+                os.close(wfd)
+
+    def test_parse_error(self):
+        path = self.write(b'[1,2,}')
+
+        gen = JsonSlicer(path, (None,), read_size=1, pipelined=True)
+        self.assertEqual(next(gen), 1)
+        self.assertEqual(next(gen), 2)
+        with self.assertRaisesRegex(RuntimeError, 'YAJL error'):
+            next(gen)
+
+    def test_error_is_sticky(self):
+        path = self.write(b'[1,2,3,}')
+
+        for pipelined in [False, True]:
+            gen = JsonSlicer(path, (None,), read_size=1, pipelined=pipelined)
+            self.assertEqual([next(gen) for _ in range(3)], [1, 2, 3])
+            for _ in range(3):
+                with self.assertRaisesRegex(RuntimeError, 'YAJL error'):
+                    next(gen)
+
+    def test_handler_error_is_sticky(self):
+        # error in the middle of a batch, the rest of which is not replayed
+        path = self.write('["a","\u00e9","b","c"]'.encode('utf-8'))
+
+        gen = JsonSlicer(path, (None,), encoding='ascii', pipelined=True)
+        with self.assertRaises(UnicodeDecodeError):
+            next(gen)
+        self.assertEqual(next(gen), 'a')
+        for _ in range(3):
+            with self.assertRaises(UnicodeDecodeError):
+                next(gen)
+
+    def test_incomplete(self):
+        path = self.write(b'[1,2')
+
+        with self.assertRaisesRegex(RuntimeError, 'YAJL error'):
+            list(JsonSlicer(path, (None,), pipelined=True))
+
+    def test_abandoned(self):
+        path = self.write(('[' + ','.join(['0'] * 100000) + ']').encode('utf-8'))
+
+        gen = JsonSlicer(path, (None,), read_size=16, pipelined=True)
+        self.assertEqual(next(gen), 0)
+        del gen
+
+    def test_reinit(self):
+        path = self.write(b'[1,2,3]')
+
+        gen = JsonSlicer(path, (None,), pipelined=True)
+        self.assertEqual(next(gen), 1)
+        gen.__init__(path, (None,), pipelined=True)
+        self.assertEqual(list(gen), [1, 2, 3])
+        gen.__init__(io.BytesIO(b'[4]'), (None,))
+        self.assertEqual(list(gen), [4])
+
+    def test_requires_native_input(self):
+        with self.assertRaises(ValueError):
+            JsonSlicer(io.BytesIO(b'[]'), (), pipelined=True)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,155 @@
+# Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+
+
+import json
+import os
+import tempfile
+import unittest
+
+from jsonslicer import JsonSlicer
+
+from .common import run_js
+
+
+DATA = b'''{
+    "items": [
+        {"id": 1, "name": "foo", "tags": ["a", "b"], "score": 1.25},
+        {"id": 2, "name": "b\\"a\\\\r\\n\\u00e9", "tags": [], "meta": {"x": null, "y": true, "z": false}},
+        3.0e10,
+        "str"
+    ]
+}'''
+
+
+class TestJsonSlicerRawOutput(unittest.TestCase):
+    def test_basic(self):
+        self.assertEqual(
+            run_js(DATA, ('items', None), output='raw'),
+            [
+                b'{"id":1,"name":"foo","tags":["a","b"],"score":1.25}',
+                b'{"id":2,"name":"b\\"a\\\\r\\n\xc3\xa9","tags":[],"meta":{"x":null,"y":true,"z":false}}',
+                b'3.0e10',
+                b'"str"',
+            ]
+        )
+
+    def test_roundtrip(self):
+        expected = run_js(DATA, ('items', None))
+        self.assertEqual([json.loads(raw) for raw in run_js(DATA, ('items', None), output='raw')], expected)
+
+    def test_whole_document(self):
+        self.assertEqual(run_js(b' [1, {"a" : [ ]}] ', (), output='raw'), [b'[1,{"a":[]}]'])
+
+    def test_text_input(self):
+        self.assertEqual(run_js(DATA.decode('utf-8'), ('items', 0, 'tags'), output='raw'), [b'["a","b"]'])
+
+    def test_numbers(self):
+        # numbers are passed as is, even if they do not fit native types
+        data = b'[100000000000000000000, 0.1, -1E-3, 12]'
+        self.assertEqual(run_js(data, (None,), output='raw'), [b'100000000000000000000', b'0.1', b'-1E-3', b'12'])
+        self.assertEqual(run_js(data, (None,), output='raw', where=[((), '>', 1)]), [b'100000000000000000000', b'12'])
+
+    def test_path_modes(self):
+        self.assertEqual(
+            run_js(DATA, ('items', 0, None), output='raw', path_mode='map_keys'),
+            [('id', b'1'), ('name', b'"foo"'), ('tags', b'["a","b"]'), ('score', b'1.25')]
+        )
+        self.assertEqual(
+            run_js(DATA, ('items', 1, 'meta'), output='raw', path_mode='full'),
+            [('items', 1, 'meta', b'{"x":null,"y":true,"z":false}')]
+        )
+
+    def test_multiple_patterns(self):
+        self.assertEqual(
+            run_js(DATA, [('items', None, 'id'), ('items', 3)], output='raw'),
+            [(0, b'1'), (0, b'2'), (1, b'"str"')]
+        )
+
+    def test_fields(self):
+        self.assertEqual(
+            run_js(DATA, ('items', None), output='raw', fields=['id', ('meta', 'y')]),
+            [b'{"id":1}', b'{"id":2,"meta":{"y":true}}', b'3.0e10', b'"str"']
+        )
+
+    def test_fields_scalars(self):
+        # key is not written for scalar which is dropped because only
+        # its subfields are selected
+        self.assertEqual(run_js(b'[{"c":1,"a":"y"}]', (None,), output='raw', fields=[('a', 'c')]), [b'{}'])
+        self.assertEqual(
+            run_js(b'[{"c":1,"a":"y","b":2,"d":{"x":1,"y":2}}]', (None,), output='raw', fields=[('a', 'c'), ('b', 'c'), ('d', 'x'), 'c']),
+            [b'{"c":1,"d":{"x":1}}']
+        )
+        self.assertEqual(
+            run_js(b'[{"a":1}, {"a":{"b":2,"c":3}}, {"a":[1]}]', (None,), output='raw', fields=[('a', 'b')]),
+            [b'{}', b'{"a":{"b":2}}', b'{"a":[]}']
+        )
+
+        # same structure as when constructing objects
+        data = b'[{"c":1,"a":"y","b":[2],"d":{"x":1,"y":{"z":null}}}]'
+        fields = [('a', 'c'), ('b', 'c'), ('d', 'y', 'z'), ('d', 'x', 'q')]
+        self.assertEqual(
+            [json.loads(raw) for raw in run_js(data, (None,), output='raw', fields=fields)],
+            run_js(data, (None,), fields=fields)
+        )
+
+    def test_where(self):
+        self.assertEqual(
+            run_js(DATA, ('items', None), output='raw', where=[('score', '>', 1)], fields=['id']),
+            [b'{"id":1}']
+        )
+        self.assertEqual(
+            run_js(DATA, ('items', None), output='raw', where=[(('meta', 'x'), '==', None)], fields=['id']),
+            [b'{"id":2}']
+        )
+
+    def test_fast_skip(self):
+        data = b'[' + b','.join(b'{"id": %d, "pad": [1, {"x": "y"}]}' % i for i in range(50)) + b']'
+        for fast_skip in (True, False):
+            self.assertEqual(
+                run_js(data, (None,), output='raw', fast_skip=fast_skip, where=[('id', 'in', [10, 20])], read_size=5),
+                [b'{"id":10,"pad":[1,{"x":"y"}]}', b'{"id":20,"pad":[1,{"x":"y"}]}']
+            )
+
+    def test_pipelined(self):
+        with tempfile.NamedTemporaryFile(delete=False) as f:
+            f.write(DATA)
+        try:
+            self.assertEqual(
+                list(JsonSlicer(f.name, ('items', None, 'score'), output='raw', pipelined=True)),
+                [b'1.25']
+            )
+            self.assertEqual(
+                list(JsonSlicer(f.name, ('items', None), output='raw', pipelined=True)),
+                run_js(DATA, ('items', None), output='raw')
+            )
+        finally:
+            os.unlink(f.name)
+
+    def test_objects(self):
+        self.assertEqual(run_js(DATA, ('items', 2), output='objects'), [3.0e10])
+
+    def test_bad_args(self):
+        with self.assertRaises(ValueError):
+            run_js(DATA, (), output='bytes')
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,83 @@
+# Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+
+import io
+import os
+import tempfile
+import unittest
+
+from jsonslicer import JsonSlicer
+
+
+def make_input(count):
+    return ('[' + ','.join('{"id":%d}' % i for i in range(count)) + ']').encode('utf-8')
+
+
+class CountingReader:
+    def __init__(self, data):
+        self.data = io.BytesIO(data)
+        self.sizes = []
+
+    def read(self, size):
+        self.sizes.append(size)
+        return self.data.read(size)
+
+
+class TestJsonSlicerReadSize(unittest.TestCase):
+    def test_auto(self):
+        data = make_input(10000)
+        self.assertEqual(list(JsonSlicer(io.BytesIO(data), (None, 'id'), read_size='auto')), list(range(10000)))
+
+    def test_auto_text(self):
+        data = make_input(1000).decode('utf-8')
+        self.assertEqual(list(JsonSlicer(io.StringIO(data), (None, 'id'), read_size='auto')), list(range(1000)))
+
+    def test_auto_grows(self):
+        # no matches at all, so chunks should grow to maximum
+        reader = CountingReader(b' ' * 8 * 1024 * 1024 + b'[]')
+        self.assertEqual(list(JsonSlicer(reader, ('foo',), read_size='auto')), [])
+        self.assertEqual(reader.sizes[1], reader.sizes[0] * 2)
+        self.assertEqual(max(reader.sizes), 1024 * 1024)
+
+    def test_auto_shrinks(self):
+        # lots of tiny objects, so chunks should shrink
+        reader = CountingReader(b'[' + b','.join([b'0'] * 1024 * 1024) + b']')
+        self.assertEqual(sum(1 for _ in JsonSlicer(reader, (None,), read_size='auto')), 1024 * 1024)
+        self.assertLess(min(reader.sizes), reader.sizes[0])
+        self.assertGreaterEqual(min(reader.sizes), 1024)
+
+    def test_auto_native(self):
+        with tempfile.TemporaryDirectory() as tmpdir:
+            path = os.path.join(tmpdir, 'input.json')
+            with open(path, 'wb') as fd:
+                fd.write(make_input(10000))
+
+            self.assertEqual(list(JsonSlicer(path, (None, 'id'), read_size='auto')), list(range(10000)))
+            self.assertEqual(list(JsonSlicer(path, (None, 'id'), read_size='auto', pipelined=True)), list(range(10000)))
+
+    def test_bad_values(self):
+        with self.assertRaises(TypeError):
+            JsonSlicer(io.BytesIO(b'[]'), (), read_size='fast')
+        with self.assertRaises(TypeError):
+            JsonSlicer(io.BytesIO(b'[]'), (), read_size=1.5)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,117 @@
+# Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+
+
+
+
+import io
+import os
+import tempfile
+import unittest
+
+from jsonslicer import JsonSlicer
+
+
+DATA = b'{"meta": {"x": [1, 2]}, "items": [{"a": 1, "b": [true, null]}, {"a": "s"}, 2.5]}'
+
+
+class TestJsonSlicerStats(unittest.TestCase):
+    def test_counters(self):
+        slicer = JsonSlicer(io.BytesIO(DATA), ('items', None), read_size=16)
+        self.assertEqual(len(list(slicer)), 3)
+        self.assertEqual(
+            slicer.stats,
+            {
+                'bytes_read': len(DATA),
+                'chunks_read': 5,
+                'tokens': {
+                    'null': 1,
+                    'boolean': 1,
+                    'number': 4,
+                    'string': 1,
+                    'map_key': 6,
+                    'start_map': 4,
+                    'end_map': 4,
+                    'start_array': 3,
+                    'end_array': 3,
+                },
+                'objects': 3,
+                'skipped_subtrees': 1,
+                'peak_complete': 2,
+                'peak_depth': 2,
+            }
+        )
+
+    def test_initial(self):
+        stats = JsonSlicer(io.BytesIO(DATA), ('items', None)).stats
+        self.assertEqual(stats['bytes_read'], 0)
+        self.assertEqual(stats['objects'], 0)
+        self.assertEqual(sum(stats['tokens'].values()), 0)
+
+    def test_fast_skip(self):
+        # skipped subtrees are not tokenized, and parser restarts are
+        # not counted
+        slicer = JsonSlicer(io.BytesIO(DATA), ('items', None), fast_skip=True)
+        list(slicer)
+        self.assertEqual(slicer.stats['skipped_subtrees'], 1)
+        self.assertEqual(slicer.stats['tokens']['start_array'], 2)
+        self.assertEqual(slicer.stats['tokens']['end_array'], 2)
+        self.assertEqual(slicer.stats['tokens']['null'], 1)
+
+    def test_fields(self):
+        slicer = JsonSlicer(io.BytesIO(DATA), ('items', None), fields=['a'])
+        list(slicer)
+        self.assertEqual(slicer.stats['skipped_subtrees'], 2)
+        self.assertEqual(slicer.stats['peak_depth'], 1)
+
+    def test_ndjson(self):
+        slicer = JsonSlicer(io.BytesIO(DATA), ('items', None))
+        slicer.dump_ndjson(io.BytesIO())
+        self.assertEqual(slicer.stats['objects'], 3)
+
+    def test_timing(self):
+        slicer = JsonSlicer(io.BytesIO(DATA), ('items', None))
+        list(slicer)
+        self.assertNotIn('parse_ns', slicer.stats)
+
+        for output in ['objects', 'raw']:
+            slicer = JsonSlicer(io.BytesIO(DATA), ('items', None), timing=True, output=output)
+            list(slicer)
+            for key in ['read_ns', 'parse_ns', 'handlers_ns']:
+                self.assertIn(key, slicer.stats)
+            self.assertGreater(slicer.stats['handlers_ns'], 0)
+            self.assertEqual(slicer.stats['objects'], 3)
+
+    def test_native(self):
+        with tempfile.TemporaryDirectory() as tmpdir:
+            input_path = os.path.join(tmpdir, 'input.json')
+            with open(input_path, 'wb') as fd:
+                fd.write(b'[' + b','.join(b'{"n":%d}' % i for i in range(10000)) + b']')
+            size = os.path.getsize(input_path)
+
+            for kwargs in [{}, {'pipelined': True}, {'threads': 2, 'read_size': 1000}]:
+                slicer = JsonSlicer(input_path, (None,), **kwargs)
+                self.assertEqual(len(list(slicer)), 10000)
+                self.assertEqual(slicer.stats['bytes_read'], size, kwargs)
+                self.assertEqual(slicer.stats['tokens']['map_key'], 10000, kwargs)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,205 @@
+# Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+
+
+
+import io
+import json
+import os
+import tempfile
+import unittest
+import warnings
+
+from jsonslicer import JsonSlicer
+
+
+class TestJsonSlicerThreads(unittest.TestCase):
+    def setUp(self):
+        self.dir = tempfile.TemporaryDirectory()
+
+    def tearDown(self):
+        self.dir.cleanup()
+
+    def write(self, data):
+        path = os.path.join(self.dir.name, 'input.json')
+        with open(path, 'wb') as fd:
+            fd.write(data)
+        return path
+
+    def test_same_results(self):
+        path = self.write(b' [{"a":[1,{"b":"]"}]},"x\\"]\\\\",[[],{}],{"c":"\\u00e9"} , 2.5,true,null,{"a":[3]}] ')
+
+        for read_size in [1, 2, 3, 7, 1024]:
+            for threads in [1, 2, 4]:
+                for pattern in [(), (None,), (None, 'a'), (None, 'a', None), (None, None), (5,)]:
+                    for path_mode in ['ignore', 'full']:
+                        expected = list(JsonSlicer(path, pattern, path_mode=path_mode))
+                        actual = list(JsonSlicer(path, pattern, read_size=read_size, path_mode=path_mode, threads=threads))
+                        self.assertEqual(actual, expected)
+
+    def test_tricky_strings(self):
+        data = [
+            '"quoted" {not} [a] container, with commas', '\\', '\\"', '\\\\",]',
+            {'k%d' % i: '],' if i % 2 else '[,' for i in range(30)},
+            ['}]' * 30, '[{' * 30, ',' * 70],
+        ] * 20
+        path = self.write(json.dumps(data).encode('utf-8'))
+
+        for read_size in [1, 5, 33, 100]:
+            self.assertEqual(list(JsonSlicer(path, (None,), read_size=read_size, threads=3)), data)
+
+    def test_many_segments(self):
+        path = self.write(('[' + ','.join('{"id":%d,"name":"item%d"}' % (i, i) for i in range(10000)) + ']').encode('utf-8'))
+
+        for threads in [1, 3, 8]:
+            self.assertEqual(list(JsonSlicer(path, (None, 'id'), read_size=64, threads=threads)), list(range(10000)))
+
+    def test_nested_array(self):
+        path = self.write(
+            b' {"meta": {"items": [0], "x": "\\"items\\": ["}, "skip": [[1], {"a": "]"}], "n": -1.5e3, "s": "}",'
+            b' "items" : {"list": [{"a": 1, "b": [2]}, "x]", [3, {"c": 4}], {"a": 5}], "after": [6]}, "tail": {"a": 7}} '
+        )
+
+        for read_size in [1, 2, 7, 1024]:
+            for pattern in [('items', 'list', None), ('items', 'list', None, 'a'), ('items', None, None), ('items', 'list'), (None, None, None), [('meta', 'items', None), ('items', 'list', 1)]]:
+                for path_mode in ['ignore', 'full']:
+                    expected = list(JsonSlicer(path, pattern, path_mode=path_mode))
+                    with warnings.catch_warnings():
+                        warnings.simplefilter('error')
+                        actual = list(JsonSlicer(path, pattern, read_size=read_size, path_mode=path_mode, threads=2))
+                    self.assertEqual(actual, expected, (read_size, pattern))
+
+    def test_nested_array_errors(self):
+        for data in [b'{"a":[1,2,}', b'{"a":[1,2', b'{"a":[1,2]', b'{"a":[1,2]}}', b'{"a":[1,2}]', b'{"a":[1 2,3]}', b'{"b":{"a":[1,2]]}']:
+            path = self.write(data)
+            with self.assertRaisesRegex(RuntimeError, 'YAJL error', msg=data), warnings.catch_warnings():
+                warnings.simplefilter('ignore')
+                list(JsonSlicer(path, ('a', None), read_size=1, threads=2))
+
+    def test_not_split(self):
+        # no array leading to matches, or escaped key which is not
+        # decoded when looking for it
+        for data, pattern, expected in [
+            (b'{"a":1,"b":[2]}', ('a',), [1]),
+            (b'{"a":{"b":1},"c":[2]}', ('a', 'b'), [1]),
+            (b'{"\\u0061":[1,2]}', ('a', None), [1, 2]),
+            (b'"str"', (), ['str']),
+        ]:
+            path = self.write(data)
+            with self.assertWarnsRegex(RuntimeWarning, 'cannot be split'):
+                self.assertEqual(list(JsonSlicer(path, pattern, read_size=1, threads=2)), expected)
+
+    def test_options(self):
+        path = self.write(b'[{"id":1,"v":0.5},{"id":2,"v":1.5},{"id":3,"v":2.5}]')
+
+        self.assertEqual(list(JsonSlicer(path, (None,), read_size=1, threads=2, fields=['id'], where=[('v', '>', 1)])), [{'id': 2}, {'id': 3}])
+        self.assertEqual(list(JsonSlicer(path, (None, 'v'), read_size=1, threads=2, output='raw')), [b'0.5', b'1.5', b'2.5'])
+        self.assertEqual(JsonSlicer(path, (None,), read_size=1, threads=2).aggregate(sum='v', max='v'), {'count': 3, 'sum': 4.5, 'max': 2.5})
+
+    def test_comments(self):
+        path = self.write(b'[1, /* , */ 2, 3]')
+
+        with self.assertWarnsRegex(RuntimeWarning, 'cannot be split'):
+            self.assertEqual(list(JsonSlicer(path, (None,), read_size=1, threads=2, yajl_allow_comments=True)), [1, 2, 3])
+
+    def test_multiple_values(self):
+        path = self.write(b'[1,2] [3,4]')
+
+        self.assertEqual(list(JsonSlicer(path, (None,), read_size=1, threads=2, yajl_allow_multiple_values=True)), [1, 2, 3, 4])
+
+        path = self.write(b'{"a":[1,2]} {"a":[3,4]}')
+
+        self.assertEqual(list(JsonSlicer(path, ('a', None), read_size=1, threads=2, yajl_allow_multiple_values=True)), [1, 2, 3, 4])
+
+    def test_parse_errors(self):
+        for data in [b'[1,2,}', b'[1,2', b'[1,2,]', b'[1 2,3]', b'[1,,2]', b'[1,2]]', b'["a,2]', b'[{"a":1,2]']:
+            path = self.write(data)
+            with self.assertRaisesRegex(RuntimeError, 'YAJL error', msg=data):
+                list(JsonSlicer(path, (None,), read_size=1, threads=2))
+
+    def test_errors_are_sticky(self):
+        path = self.write(b'[1,2,3,}')
+
+        gen = JsonSlicer(path, (None,), read_size=1, threads=2)
+        self.assertEqual([next(gen) for _ in range(3)], [1, 2, 3])
+        for _ in range(3):
+            with self.assertRaisesRegex(RuntimeError, 'YAJL error'):
+                next(gen)
+
+        # error in the middle of a segment
+        path = self.write('["a","\u00e9","b","c"]'.encode('utf-8'))
+
+        gen = JsonSlicer(path, (None,), encoding='ascii', threads=2)
+        with self.assertRaises(UnicodeDecodeError):
+            next(gen)
+        self.assertEqual(next(gen), 'a')
+        for _ in range(3):
+            with self.assertRaises(UnicodeDecodeError):
+                next(gen)
+
+    def test_many_threads(self):
+        # capped at hardware threads
+        path = self.write(('[' + ','.join(['0'] * 1000) + ']').encode('utf-8'))
+        self.assertEqual(list(JsonSlicer(path, (None,), read_size=16, threads=100000)), [0] * 1000)
+
+    def test_abandoned(self):
+        path = self.write(('[' + ','.join(['0'] * 100000) + ']').encode('utf-8'))
+
+        gen = JsonSlicer(path, (None,), read_size=16, threads=4)
+        self.assertEqual(next(gen), 0)
+        del gen
+
+    def test_reinit(self):
+        path = self.write(b'[1,2,3]')
+
+        gen = JsonSlicer(path, (None,), read_size=1, threads=2)
+        self.assertEqual(next(gen), 1)
+        gen.__init__(path, (None,), read_size=1, threads=2)
+        self.assertEqual(list(gen), [1, 2, 3])
+        gen.__init__(io.BytesIO(b'[4]'), (None,))
+        self.assertEqual(list(gen), [4])
+
+    def test_unmapped_input(self):
+        # input which cannot be memory mapped is handled as in
+        # pipelined mode
+        rfd, wfd = os.pipe()
+        try:
+            os.write(wfd, b'[1,2,3]')
+            os.close(wfd)
+            wfd = None
+            with self.assertWarnsRegex(RuntimeWarning, 'cannot be memory mapped'):
+                self.assertEqual(list(JsonSlicer(rfd, (None,), threads=2)), [1, 2, 3])
+        finally:
+            os.close(rfd)
+            if wfd is not None:
+                os.close(wfd)
+
+        with self.assertWarnsRegex(RuntimeWarning, 'cannot be memory mapped'):
+            self.assertEqual(list(JsonSlicer(self.write(b''), (None,), threads=2, yajl_allow_partial_values=True)), [])
+
+    def test_bad_arguments(self):
+        with self.assertRaises(ValueError):
+            JsonSlicer(io.BytesIO(b'[]'), (), threads=2)
+        with self.assertRaises(ValueError):
+            JsonSlicer(self.write(b'[]'), (), threads=-1)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,164 @@
+# Copyright (c) 2019 Dmitry Marakasov <amdmi3@amdmi3.ru>
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+
+
+import os
+import tempfile
+import unittest
+
+from jsonslicer import JsonSlicer
+
+from .common import run_js
+
+
+DATA = b'''[
+    {"id": 1, "name": "foo", "score": 1.5, "active": true, "tags": ["a", "b"], "meta": {"author": {"name": "x"}}},
+    {"id": 2, "name": "bar", "score": 3, "active": false, "tags": ["c"], "meta": null},
+    {"id": 3, "name": "baz", "active": null, "tags": [], "meta": {"author": {"name": "y"}}},
+    {"name": "qux"}
+]'''
+
+
+def ids(objects):
+    return [obj.get('id') for obj in objects]
+
+
+class TestJsonSlicerWhere(unittest.TestCase):
+    def test_comparisons(self):
+        self.assertEqual(ids(run_js(DATA, (None,), where=[('id', '==', 2)])), [2])
+        self.assertEqual(ids(run_js(DATA, (None,), where=[('id', '!=', 2)])), [1, 3])
+        self.assertEqual(ids(run_js(DATA, (None,), where=[('id', '<', 2)])), [1])
+        self.assertEqual(ids(run_js(DATA, (None,), where=[('id', '<=', 2)])), [1, 2])
+        self.assertEqual(ids(run_js(DATA, (None,), where=[('id', '>', 2)])), [3])
+        self.assertEqual(ids(run_js(DATA, (None,), where=[('id', '>=', 2)])), [2, 3])
+
+    def test_numbers(self):
+        self.assertEqual(ids(run_js(DATA, (None,), where=[('score', '>', 2)])), [2])
+        self.assertEqual(ids(run_js(DATA, (None,), where=[('score', '==', 3.0)])), [2])
+        self.assertEqual(ids(run_js(DATA, (None,), where=[('score', '<', 1.6)])), [1])
+        self.assertEqual(ids(run_js(DATA, (None,), where=[('id', '==', 1.0)])), [1])
+
+    def test_strings(self):
+        self.assertEqual(ids(run_js(DATA, (None,), where=[('name', '==', 'bar')])), [2])
+        self.assertEqual(ids(run_js(DATA, (None,), where=[('name', '>', 'bar')])), [1, 3, None])
+        self.assertEqual(ids(run_js(DATA, (None,), where=[('name', '==', b'foo')])), [1])
+        # strings are never equal to numbers
+        self.assertEqual(ids(run_js(DATA, (None,), where=[('id', '==', '1')])), [])
+
+    def test_constants(self):
+        self.assertEqual(ids(run_js(DATA, (None,), where=[('active', '==', True)])), [1])
+        self.assertEqual(ids(run_js(DATA, (None,), where=[('active', '==', False)])), [2])
+        self.assertEqual(ids(run_js(DATA, (None,), where=[('active', '==', None)])), [3])
+        self.assertEqual(ids(run_js(DATA, (None,), where=[('meta', '!=', None)])), [1, 3])
+
+    def test_in(self):
+        self.assertEqual(ids(run_js(DATA, (None,), where=[('id', 'in', [1, 3, 5])])), [1, 3])
+        self.assertEqual(ids(run_js(DATA, (None,), where=[('name', 'in', ('bar', 'qux'))])), [2, None])
+        self.assertEqual(ids(run_js(DATA, (None,), where=[('id', 'in', [])])), [])
+
+    def test_exists(self):
+        self.assertEqual(ids(run_js(DATA, (None,), where=[('score', 'exists')])), [1, 2])
+        self.assertEqual(ids(run_js(DATA, (None,), where=[('meta', 'exists')])), [1, 2, 3])
+
+    def test_missing_field(self):
+        # condition on missing field never holds
+        self.assertEqual(ids(run_js(DATA, (None,), where=[('score', '!=', 0)])), [1, 2])
+
+    def test_conjunction(self):
+        self.assertEqual(ids(run_js(DATA, (None,), where=[('id', '>', 1), ('name', '!=', 'baz')])), [2])
+        self.assertEqual(ids(run_js(DATA, (None,), where=[])), [1, 2, 3, None])
+        self.assertEqual(ids(run_js(DATA, (None,), where=None)), [1, 2, 3, None])
+
+    def test_nested(self):
+        self.assertEqual(ids(run_js(DATA, (None,), where=[(('meta', 'author', 'name'), '==', 'y')])), [3])
+        self.assertEqual(ids(run_js(DATA, (None,), where=[(('tags', 0), '==', 'c')])), [2])
+
+    def test_wildcards(self):
+        # wildcard condition holds if any of matching values satisfies it
+        self.assertEqual(ids(run_js(DATA, (None,), where=[(('tags', None), '==', 'b')])), [1])
+        self.assertEqual(ids(run_js(DATA, (None,), where=[(('meta', None, 'name'), '==', 'x')])), [1])
+
+    def test_scalars(self):
+        self.assertEqual(run_js(b'[1, 5, "a", 10]', (None,), where=[((), '>', 3)]), [5, 10])
+
+    def test_output_unaffected(self):
+        self.assertEqual(
+            run_js(DATA, (None,), where=[('id', '==', 1)]),
+            [{'id': 1, 'name': 'foo', 'score': 1.5, 'active': True, 'tags': ['a', 'b'], 'meta': {'author': {'name': 'x'}}}]
+        )
+        self.assertEqual(
+            run_js(DATA, (None,), where=[('id', '==', 2)], path_mode='full'),
+            [(1, {'id': 2, 'name': 'bar', 'score': 3, 'active': False, 'tags': ['c'], 'meta': None})]
+        )
+
+    def test_with_fields(self):
+        # filtered fields are not required to be projected
+        self.assertEqual(
+            run_js(DATA, (None,), where=[(('meta', 'author', 'name'), '==', 'x')], fields=['name']),
+            [{'name': 'foo'}]
+        )
+        self.assertEqual(
+            run_js(DATA, (None,), where=[(('tags', None), '==', 'c')], fields=['id']),
+            [{'id': 2}]
+        )
+
+    def test_fast_skip(self):
+        data = b'{"a": [' + b','.join(b'{"id": %d, "pad": [[1, 2], {"x": "y"}]}' % i for i in range(100)) + b']}'
+        for fast_skip in (True, False):
+            self.assertEqual(
+                ids(run_js(data, ('a', None), where=[('id', 'in', [5, 50, 99])], fast_skip=fast_skip, read_size=7)),
+                [5, 50, 99]
+            )
+
+    def test_pipelined(self):
+        with tempfile.NamedTemporaryFile(delete=False) as f:
+            f.write(DATA)
+        try:
+            with open(f.name, 'rb') as fd:
+                self.assertEqual(ids(JsonSlicer(fd.fileno(), (None,), where=[('id', '>', 1)], pipelined=True)), [2, 3])
+        finally:
+            os.unlink(f.name)
+
+    def test_encoding(self):
+        self.assertEqual(ids(run_js(DATA.decode('utf-8'), (None,), where=[('name', '==', 'foo')])), [1])
+
+    def test_bad_args(self):
+        with self.assertRaises(TypeError):
+            run_js(DATA, (None,), where=1)
+        with self.assertRaises(TypeError):
+            run_js(DATA, (None,), where=['id'])
+        with self.assertRaises(TypeError):
+            run_js(DATA, (None,), where=[('id', 1, 1)])
+        with self.assertRaises(ValueError):
+            run_js(DATA, (None,), where=[('id', '~', 1)])
+        with self.assertRaises(TypeError):
+            run_js(DATA, (None,), where=[('id', '==')])
+        with self.assertRaises(TypeError):
+            run_js(DATA, (None,), where=[('id', 'exists', 1)])
+        with self.assertRaises(TypeError):
+            run_js(DATA, (None,), where=[('id', '<', None)])
+        with self.assertRaises(TypeError):
+            run_js(DATA, (None,), where=[('id', '==', object())])
+        with self.assertRaises(ValueError):
+            run_js(DATA, (None,), where=[('id', '==', 1)] * 65)
+
+
+if __name__ == '__main__':
+    unittest.main()